@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+//bounded lock free queue, any number of producer threads, one consumer thread.
+//each cell carries a sequence number so producers only contend on one atomic counter
+template <typename T, std::size_t Capacity>
+class BoundedMpscQueue
+{
+public:
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+	BoundedMpscQueue() : cells_(std::make_unique<Cell[]>(Capacity))
+	{
+		for (std::size_t i = 0; i < Capacity; ++i)
+		{
+			cells_[i].sequence_.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	BoundedMpscQueue(const BoundedMpscQueue&) = delete;
+	BoundedMpscQueue& operator=(const BoundedMpscQueue&) = delete;
+
+	inline static constexpr std::size_t capacity() { return Capacity; }
+
+	//returns false when the queue is full, the caller decides whether to retry or reject
+	bool TryPush(T value)
+	{
+		auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			auto& cell = cells_[pos & kMask];
+			const auto sequence = cell.sequence_.load(std::memory_order_acquire);
+			const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+			if (0 == diff)
+			{
+				if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					cell.value_ = std::move(value);
+					cell.sequence_.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = enqueue_pos_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	//consumer thread only
+	bool TryPop(T& value)
+	{
+		auto& cell = cells_[dequeue_pos_ & kMask];
+		const auto sequence = cell.sequence_.load(std::memory_order_acquire);
+		if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(dequeue_pos_ + 1) < 0)
+		{
+			return false;
+		}
+		value = std::move(cell.value_);
+		cell.sequence_.store(dequeue_pos_ + Capacity, std::memory_order_release);
+		++dequeue_pos_;
+		return true;
+	}
+
+private:
+	static constexpr std::size_t kMask = Capacity - 1;
+
+	struct Cell
+	{
+		std::atomic<std::size_t> sequence_{ 0 };
+		T value_{};
+	};
+
+	std::unique_ptr<Cell[]> cells_;
+	alignas(64) std::atomic<std::size_t> enqueue_pos_{ 0 };
+	alignas(64) std::size_t dequeue_pos_{ 0 };
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "teams/team_metrics.h"
+
+//a bucket holds burst_ requests and gains per_second_ more every second, a zero burst turns the limit off
+struct TeamRateLimit
+{
+	inline bool enabled() const { return burst_ > 0; }
+
+	uint32_t burst_{ 0 };
+	uint32_t per_second_{ 0 };
+};
+
+//milliseconds on steady_clock, for team code that cannot wait on the team timing wheel to be advanced
+inline uint64_t TeamSteadyClockMs()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+using TeamClock = uint64_t (*)();
+
+//tokens are kept in thousandths, so per_second_ is also the refill per millisecond and no division is needed.
+//a new bucket starts full
+class TeamTokenBucket
+{
+public:
+	static constexpr uint64_t kTokenScale = 1000;
+
+	TeamTokenBucket() = default;
+	TeamTokenBucket(const TeamRateLimit& limit, const uint64_t now_ms)
+		: refill_ms_(now_ms), milli_tokens_(static_cast<uint32_t>(limit.burst_ * kTokenScale))
+	{
+	}
+
+	inline uint32_t tokens() const { return static_cast<uint32_t>(milli_tokens_ / kTokenScale); }
+	inline bool HasToken() const { return milli_tokens_ >= kTokenScale; }
+
+	//refills for the time since the last call
+	void Refill(const TeamRateLimit& limit, const uint64_t now_ms)
+	{
+		if (now_ms > refill_ms_)
+		{
+			const auto capacity = limit.burst_ * kTokenScale;
+			milli_tokens_ = static_cast<uint32_t>(std::min<uint64_t>(capacity, milli_tokens_ + (now_ms - refill_ms_) * limit.per_second_));
+			refill_ms_ = now_ms;
+		}
+	}
+
+	//call after HasToken
+	void Take() { milli_tokens_ -= static_cast<uint32_t>(kTokenScale); }
+
+private:
+	uint64_t refill_ms_{ 0 };
+	uint32_t milli_tokens_{ 0 };
+};
+
+//on the player entity, shared by every rate limited request of the player
+struct PlayerTeamRequestBucket : TeamTokenBucket
+{
+	using TeamTokenBucket::TeamTokenBucket;
+};
+
+//on the team entity, shared by every player sending rate limited requests to the team
+struct TeamRequestBucket : TeamTokenBucket
+{
+	using TeamTokenBucket::TeamTokenBucket;
+};
+
+struct TeamAdmissionCounters
+{
+	uint64_t player_rejected_{ 0 };
+	uint64_t team_rejected_{ 0 };
+};
+
+//limits and rejection counters of one team thread, both limits are off by default.
+//buckets refill on steady_clock milliseconds, not on the team timing wheel, so a thread that never
+//calls UpdateTimers still refills them. tests can swap the clock
+class TeamAdmission
+{
+public:
+	inline uint64_t now_ms() const { return clock_(); }
+
+	inline bool enabled() const { return player_limit_.enabled() || team_limit_.enabled(); }
+	inline const TeamRateLimit& player_limit() const { return player_limit_; }
+	inline const TeamRateLimit& team_limit() const { return team_limit_; }
+	inline const TeamAdmissionCounters& counters(const TeamOp op) const { return counter_list_[static_cast<std::size_t>(op)]; }
+
+	//a bucket created under an older limit is clamped to the new burst at its next refill
+	void SetPlayerLimit(const TeamRateLimit& limit) { player_limit_ = limit; }
+	void SetTeamLimit(const TeamRateLimit& limit) { team_limit_ = limit; }
+	//nullptr goes back to steady_clock
+	void SetClock(const TeamClock clock) { clock_ = nullptr == clock ? &TeamSteadyClockMs : clock; }
+
+	void OnPlayerRejected(const TeamOp op) { ++counter_list_[static_cast<std::size_t>(op)].player_rejected_; }
+	void OnTeamRejected(const TeamOp op) { ++counter_list_[static_cast<std::size_t>(op)].team_rejected_; }
+
+	uint64_t rejected_size() const
+	{
+		uint64_t size = 0;
+		for (const auto& counters : counter_list_)
+		{
+			size += counters.player_rejected_ + counters.team_rejected_;
+		}
+		return size;
+	}
+
+	void ClearCounters() { counter_list_.fill({}); }
+
+private:
+	TeamRateLimit player_limit_;
+	TeamRateLimit team_limit_;
+	TeamClock clock_{ &TeamSteadyClockMs };
+	std::array<TeamAdmissionCounters, kTeamOpSize> counter_list_{};
+};
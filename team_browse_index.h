@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "type_define/type_define.h"
+
+//position of a paged browse, default constructed starts from the first bucket
+struct TeamBrowseCursor
+{
+	inline bool finished() const { return finished_; }
+
+	std::size_t bucket_{ 0 };
+	uint64_t sequence_{ 0 };
+	Guid team_id_{ kInvalidGuid };
+	bool finished_{ false };
+};
+
+//teams that still have free slots, bucketed by free slot count then team capacity.
+//a bucket is a list in the order teams entered it, so a cursor resumes right after the last team it returned
+template <std::size_t MaxCapacity>
+class TeamBrowseIndex
+{
+public:
+	static constexpr std::size_t kBucketSize = MaxCapacity * MaxCapacity;
+
+	TeamBrowseIndex() { node_list_.reserve(1024); }
+
+	inline std::size_t size() const { return open_size_; }
+	inline std::size_t bucket_size(const std::size_t free_slots, const std::size_t capacity) const
+	{
+		if (0 == free_slots || free_slots > capacity || capacity > MaxCapacity)
+		{
+			return 0;
+		}
+		return bucket_list_[BucketIndex(free_slots, capacity)].size_;
+	}
+
+	//called whenever the member count of a team changes, a full team keeps its node but leaves every bucket
+	void Update(const Guid team_id, std::size_t capacity, const std::size_t member_size)
+	{
+		capacity = std::min(capacity, MaxCapacity);
+		const auto bucket = member_size >= capacity ? kBucketSize : BucketIndex(capacity - member_size, capacity);
+		auto& node = node_list_[team_id];
+		if (node.bucket_ == bucket)
+		{
+			return;
+		}
+		Unlink(node);
+		if (bucket < kBucketSize)
+		{
+			Link(team_id, node, bucket);
+		}
+	}
+
+	//called when the team is destroyed
+	void Erase(const Guid team_id)
+	{
+		const auto node_it = node_list_.find(team_id);
+		if (node_it == node_list_.end())
+		{
+			return;
+		}
+		Unlink(node_it->second);
+		node_list_.erase(node_it);
+	}
+
+	void Clear()
+	{
+		node_list_.clear();
+		open_size_ = 0;
+		for (auto& bucket : bucket_list_)
+		{
+			bucket = Bucket{};
+		}
+	}
+
+	//appends up to count teams with at least min_free_slots free, fewest free slots first.
+	//capacity 0 matches every team type. returns how many were appended
+	std::size_t Find(const std::size_t min_free_slots, const std::size_t capacity, const std::size_t count,
+		GuidVector& team_id_list, TeamBrowseCursor& cursor) const
+	{
+		std::size_t found = 0;
+		if (cursor.finished_)
+		{
+			return found;
+		}
+		const std::size_t first_bucket = BucketIndex(std::max<std::size_t>(min_free_slots, 1), 1);
+		for (std::size_t bucket = std::max(cursor.bucket_, first_bucket); bucket < kBucketSize; ++bucket)
+		{
+			const std::size_t bucket_capacity = bucket % MaxCapacity + 1;
+			if (0 != capacity && bucket_capacity != capacity)
+			{
+				continue;
+			}
+			Guid team_id = cursor.bucket_ == bucket ? ResumeAfter(cursor) : bucket_list_[bucket].head_;
+			for (; kInvalidGuid != team_id; team_id = node_list_.at(team_id).next_)
+			{
+				if (found >= count)
+				{
+					return found;
+				}
+				const auto& node = node_list_.at(team_id);
+				team_id_list.emplace_back(team_id);
+				cursor.bucket_ = bucket;
+				cursor.sequence_ = node.sequence_;
+				cursor.team_id_ = team_id;
+				++found;
+			}
+			cursor.bucket_ = bucket + 1;
+			cursor.sequence_ = 0;
+			cursor.team_id_ = kInvalidGuid;
+		}
+		cursor.finished_ = true;
+		return found;
+	}
+
+private:
+	struct Node
+	{
+		Guid prev_{ kInvalidGuid };
+		Guid next_{ kInvalidGuid };
+		std::size_t bucket_{ kBucketSize };
+		uint64_t sequence_{ 0 };
+	};
+
+	struct Bucket
+	{
+		Guid head_{ kInvalidGuid };
+		Guid tail_{ kInvalidGuid };
+		std::size_t size_{ 0 };
+	};
+
+	static inline std::size_t BucketIndex(const std::size_t free_slots, const std::size_t capacity)
+	{
+		return (free_slots - 1) * MaxCapacity + (capacity - 1);
+	}
+
+	//the team the cursor stopped at is usually still in place, otherwise walk back from the tail
+	//past every team that entered the bucket after the cursor was taken
+	Guid ResumeAfter(const TeamBrowseCursor& cursor) const
+	{
+		if (0 == cursor.sequence_)
+		{
+			return bucket_list_[cursor.bucket_].head_;
+		}
+		if (const auto node_it = node_list_.find(cursor.team_id_);
+			node_it != node_list_.end() && node_it->second.bucket_ == cursor.bucket_ && node_it->second.sequence_ == cursor.sequence_)
+		{
+			return node_it->second.next_;
+		}
+		Guid next_id = kInvalidGuid;
+		for (Guid team_id = bucket_list_[cursor.bucket_].tail_; kInvalidGuid != team_id; )
+		{
+			const auto& node = node_list_.at(team_id);
+			if (node.sequence_ <= cursor.sequence_)
+			{
+				break;
+			}
+			next_id = team_id;
+			team_id = node.prev_;
+		}
+		return next_id;
+	}
+
+	void Link(const Guid team_id, Node& node, const std::size_t bucket)
+	{
+		auto& list = bucket_list_[bucket];
+		node.bucket_ = bucket;
+		node.sequence_ = ++sequence_;
+		node.prev_ = list.tail_;
+		node.next_ = kInvalidGuid;
+		if (kInvalidGuid == list.tail_)
+		{
+			list.head_ = team_id;
+		}
+		else
+		{
+			node_list_.at(list.tail_).next_ = team_id;
+		}
+		list.tail_ = team_id;
+		++list.size_;
+		++open_size_;
+	}
+
+	void Unlink(Node& node)
+	{
+		if (node.bucket_ >= kBucketSize)
+		{
+			return;
+		}
+		auto& list = bucket_list_[node.bucket_];
+		if (kInvalidGuid == node.prev_)
+		{
+			list.head_ = node.next_;
+		}
+		else
+		{
+			node_list_.at(node.prev_).next_ = node.next_;
+		}
+		if (kInvalidGuid == node.next_)
+		{
+			list.tail_ = node.prev_;
+		}
+		else
+		{
+			node_list_.at(node.next_).prev_ = node.prev_;
+		}
+		--list.size_;
+		--open_size_;
+		node.prev_ = kInvalidGuid;
+		node.next_ = kInvalidGuid;
+		node.bucket_ = kBucketSize;
+	}
+
+	std::unordered_map<Guid, Node> node_list_;
+	Bucket bucket_list_[kBucketSize];
+	uint64_t sequence_{ 0 };
+	std::size_t open_size_{ 0 };
+};
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "teams/bounded_mpsc_queue.h"
+#include "teams/team_system.h"
+
+static constexpr std::size_t kTeamCommandQueueSize = 4096;
+
+enum class TeamCommandType : uint8_t
+{
+	kCreateTeam,
+	kJoinTeam,
+	kLeaveTeam,
+	kKickMember,
+	kApplyToTeam,
+	kDelApplicant,
+	kAppointLeader,
+	kDisbanded,
+	//shard to shard player ownership messages, TeamShard handles them and they never reach a TeamCommandBuffer.
+	//kReserve and kCheck: request_id_ token, guid_ player, target_id_ asking shard index
+	kReserve,
+	kCheck,
+	//request_id_ token, guid_ player, target_id_ return code
+	kReserveResult,
+	//guid_ player, team_id_ sharded team id, kInvalidGuid for a reservation that never became a membership
+	kConfirm,
+	kRelease,
+};
+
+struct TeamCommandResult
+{
+	uint64_t request_id_{ 0 };
+	uint32_t ret_{ kOK };
+	Guid team_id_{ kInvalidGuid };
+};
+
+using TeamCommandResultVector = std::vector<TeamCommandResult>;
+using TeamReplyQueue = BoundedMpscQueue<TeamCommandResult, kTeamCommandQueueSize>;
+
+struct TeamCommand
+{
+	TeamCommandType type_{ TeamCommandType::kJoinTeam };
+	uint64_t request_id_{ 0 };
+	Guid team_id_{ kInvalidGuid };
+	Guid guid_{ kInvalidGuid };
+	Guid target_id_{ kInvalidGuid };
+	TeamMemberVector member_list_;
+	TeamReplyQueue* reply_queue_{ nullptr };
+	//team type of a kCreateTeam
+	std::size_t team_type_size_{ kFiveMemberMaxSize };
+};
+
+//collects the team commands of one tick and runs them grouped by team. each team is resolved once per group,
+//teams run in ascending team id and a team's commands in arrival order, new teams are created after every group.
+//a player who shows up again after a command on another team starts a new round, so every player's and every
+//team's commands still run in arrival order. the same commands in the same order always give the same results
+class TeamCommandBuffer
+{
+public:
+	explicit TeamCommandBuffer(TeamSystem& team_system) : team_system_(team_system) {}
+
+	inline std::size_t size() const { return command_list_.size(); }
+	inline bool empty() const { return command_list_.empty(); }
+
+	void Push(const TeamCommand& command) { command_list_.emplace_back(command); }
+
+	//result_list[i] is the result of the i-th command pushed since the last flush
+	void Flush(TeamCommandResultVector& result_list)
+	{
+		result_list.resize(command_list_.size());
+		order_list_.clear();
+		player_round_list_.clear();
+		team_round_list_.clear();
+		for (std::size_t i = 0; i < command_list_.size(); ++i)
+		{
+			const auto& command = command_list_[i];
+			result_list[i] = { command.request_id_, kOK, command.team_id_ };
+			const bool create = TeamCommandType::kCreateTeam == command.type_;
+			order_list_.push_back({ Round(command, create), create, command.team_id_, i });
+		}
+		std::sort(order_list_.begin(), order_list_.end());
+
+		for (std::size_t first = 0; first < order_list_.size();)
+		{
+			auto last = first;
+			while (last < order_list_.size() && order_list_[last].round_ == order_list_[first].round_ &&
+				order_list_[last].create_ == order_list_[first].create_ && order_list_[last].team_id_ == order_list_[first].team_id_)
+			{
+				++last;
+			}
+			if (order_list_[first].create_)
+			{
+				for (auto i = first; i < last; ++i)
+				{
+					ExecuteCreate(command_list_[order_list_[i].index_], result_list[order_list_[i].index_]);
+				}
+			}
+			else
+			{
+				ExecuteGroup(first, last, result_list);
+			}
+			first = last;
+		}
+		command_list_.clear();
+	}
+
+private:
+	struct Order
+	{
+		uint32_t round_{ 0 };
+		bool create_{ false };
+		Guid team_id_{ kInvalidGuid };
+		std::size_t index_{ 0 };
+
+		bool operator<(const Order& rhs) const
+		{
+			if (round_ != rhs.round_)
+			{
+				return round_ < rhs.round_;
+			}
+			if (create_ != rhs.create_)
+			{
+				return rhs.create_;
+			}
+			if (team_id_ != rhs.team_id_)
+			{
+				return team_id_ < rhs.team_id_;
+			}
+			return index_ < rhs.index_;
+		}
+	};
+
+	//where a player or a team was last seen, creates all share the kInvalidGuid team
+	struct LastRound
+	{
+		uint32_t round_{ 0 };
+		bool create_{ false };
+		Guid team_id_{ kInvalidGuid };
+	};
+
+	//the earliest round that runs after everything the command's players and team did before it.
+	//a round runs its groups first and its creates last, so a create can share the round of a group before it
+	uint32_t Round(const TeamCommand& command, const bool create)
+	{
+		const auto team_id = create ? kInvalidGuid : command.team_id_;
+		uint32_t round = 0;
+		if (const auto team_it = team_round_list_.find(team_id); team_it != team_round_list_.end())
+		{
+			round = team_it->second;
+		}
+		const auto after_player = [&](const Guid guid)
+		{
+			const auto player_it = player_round_list_.find(guid);
+			if (player_it == player_round_list_.end())
+			{
+				return;
+			}
+			const auto& last = player_it->second;
+			const bool same_group = last.create_ == create && last.team_id_ == team_id;
+			const bool later_in_round = create && !last.create_;
+			round = std::max(round, same_group || later_in_round ? last.round_ : last.round_ + 1);
+		};
+		after_player(command.guid_);
+		if (kInvalidGuid != command.target_id_)
+		{
+			after_player(command.target_id_);
+		}
+		for (const auto& member_it : command.member_list_)
+		{
+			after_player(member_it);
+		}
+
+		team_round_list_[team_id] = round;
+		player_round_list_[command.guid_] = { round, create, team_id };
+		if (kInvalidGuid != command.target_id_)
+		{
+			player_round_list_[command.target_id_] = { round, create, team_id };
+		}
+		for (const auto& member_it : command.member_list_)
+		{
+			player_round_list_[member_it] = { round, create, team_id };
+		}
+		return round;
+	}
+
+	void ExecuteGroup(const std::size_t first, const std::size_t last, TeamCommandResultVector& result_list)
+	{
+		TeamHandle team(order_list_[first].team_id_);
+		for (auto i = first; i < last; ++i)
+		{
+			const auto index = order_list_[i].index_;
+			const auto& command = command_list_[index];
+			auto& ret = result_list[index].ret_;
+			switch (command.type_)
+			{
+			case TeamCommandType::kJoinTeam:
+				ret = TeamSystem::JoinTeam(team, command.guid_);
+				break;
+			case TeamCommandType::kLeaveTeam:
+				ret = TeamSystem::LeaveTeam(team, command.guid_);
+				break;
+			case TeamCommandType::kKickMember:
+				ret = TeamSystem::KickMember(team, command.guid_, command.target_id_);
+				break;
+			case TeamCommandType::kApplyToTeam:
+				ret = TeamSystem::ApplyToTeam(team, command.guid_);
+				break;
+			case TeamCommandType::kDelApplicant:
+				ret = TeamSystem::DelApplicant(team, command.target_id_);
+				break;
+			case TeamCommandType::kAppointLeader:
+				ret = TeamSystem::AppointLeader(team, command.guid_, command.target_id_);
+				break;
+			case TeamCommandType::kDisbanded:
+				ret = TeamSystem::Disbanded(team, command.guid_);
+				break;
+			default:
+				break;
+			}
+			//the last member leaving or a disband destroys the team, the rest of the group sees it gone
+			if ((TeamCommandType::kLeaveTeam == command.type_ || TeamCommandType::kDisbanded == command.type_) && kOK == ret)
+			{
+				team = TeamHandle(order_list_[first].team_id_);
+			}
+		}
+	}
+
+	void ExecuteCreate(const TeamCommand& command, TeamCommandResult& result)
+	{
+		UInt64Set member_list;
+		for (const auto& member_it : command.member_list_)
+		{
+			member_list.emplace(member_it);
+		}
+		result.ret_ = team_system_.CreateTeam({ command.guid_, member_list, command.team_type_size_ });
+		result.team_id_ = kOK == result.ret_ ? team_system_.last_team_id() : kInvalidGuid;
+	}
+
+	TeamSystem& team_system_;
+	std::vector<TeamCommand> command_list_;
+	std::vector<Order> order_list_;
+	std::unordered_map<Guid, LastRound> player_round_list_;
+	std::unordered_map<Guid, uint32_t> team_round_list_;
+};
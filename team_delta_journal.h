@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "type_define/type_define.h"
+
+//changes of one team during one tick, already coalesced
+struct TeamDelta
+{
+	inline bool empty() const
+	{
+		if (created_)
+		{
+			return disbanded_;
+		}
+		return !disbanded_ && !leader_changed_ && add_members_.empty() && del_members_.empty() &&
+			add_applicants_.empty() && del_applicants_.empty();
+	}
+
+	Guid team_id_{ kInvalidGuid };
+	Guid leader_id_{ kInvalidGuid };
+	Guid old_leader_id_{ kInvalidGuid };
+	bool created_{ false };
+	bool disbanded_{ false };
+	bool leader_changed_{ false };
+	GuidVector add_members_;
+	GuidVector del_members_;
+	GuidVector add_applicants_;
+	GuidVector del_applicants_;
+};
+
+//records TeamSystem changes and hands them out once per tick,
+//join then leave in the same tick folds to nothing, so does create then disband
+class TeamDeltaJournal
+{
+public:
+	using Sink = std::function<void(const TeamDelta&)>;
+
+	inline bool enabled() const { return enabled_; }
+	inline std::size_t size() const { return delta_list_.size(); }
+
+	void set_enabled(const bool enabled)
+	{
+		enabled_ = enabled;
+		if (!enabled_)
+		{
+			Clear();
+		}
+	}
+
+	void OnCreate(const Guid team_id, const Guid leader_id)
+	{
+		if (!enabled_)
+		{
+			return;
+		}
+		auto& delta = GetDelta(team_id);
+		delta.created_ = true;
+		delta.leader_changed_ = true;
+		delta.leader_id_ = leader_id;
+	}
+
+	void OnDisband(const Guid team_id)
+	{
+		if (!enabled_)
+		{
+			return;
+		}
+		auto& delta = GetDelta(team_id);
+		delta.disbanded_ = true;
+		delta.leader_changed_ = false;
+		delta.add_members_.clear();
+		delta.del_members_.clear();
+		delta.add_applicants_.clear();
+		delta.del_applicants_.clear();
+	}
+
+	void OnAppointLeader(const Guid team_id, const Guid old_leader_id, const Guid new_leader_id)
+	{
+		if (!enabled_)
+		{
+			return;
+		}
+		auto& delta = GetDelta(team_id);
+		if (!delta.leader_changed_)
+		{
+			delta.old_leader_id_ = old_leader_id;
+		}
+		delta.leader_id_ = new_leader_id;
+		delta.leader_changed_ = delta.created_ || delta.leader_id_ != delta.old_leader_id_;
+	}
+
+	void OnAddMember(const Guid team_id, const Guid guid)
+	{
+		if (!enabled_)
+		{
+			return;
+		}
+		auto& delta = GetDelta(team_id);
+		Fold(delta.add_members_, delta.del_members_, guid);
+	}
+
+	void OnDelMember(const Guid team_id, const Guid guid)
+	{
+		if (!enabled_)
+		{
+			return;
+		}
+		auto& delta = GetDelta(team_id);
+		Fold(delta.del_members_, delta.add_members_, guid);
+	}
+
+	void OnAddApplicant(const Guid team_id, const Guid guid)
+	{
+		if (!enabled_)
+		{
+			return;
+		}
+		auto& delta = GetDelta(team_id);
+		Fold(delta.add_applicants_, delta.del_applicants_, guid);
+	}
+
+	void OnDelApplicant(const Guid team_id, const Guid guid)
+	{
+		if (!enabled_)
+		{
+			return;
+		}
+		auto& delta = GetDelta(team_id);
+		Fold(delta.del_applicants_, delta.add_applicants_, guid);
+	}
+
+	//call once per tick, the sink builds the team_comp message for each changed team
+	void Flush(const Sink& sink)
+	{
+		for (const auto& delta : delta_list_)
+		{
+			if (!delta.empty())
+			{
+				sink(delta);
+			}
+		}
+		Clear();
+	}
+
+	void Clear()
+	{
+		delta_list_.clear();
+		delta_index_.clear();
+	}
+
+private:
+	TeamDelta& GetDelta(const Guid team_id)
+	{
+		const auto [it, inserted] = delta_index_.try_emplace(team_id, delta_list_.size());
+		if (inserted)
+		{
+			delta_list_.emplace_back().team_id_ = team_id;
+		}
+		return delta_list_[it->second];
+	}
+
+	//a change that undoes an opposite change in the same tick removes both
+	static void Fold(GuidVector& to, GuidVector& opposite, const Guid guid)
+	{
+		if (const auto it = std::find(opposite.begin(), opposite.end(), guid); it != opposite.end())
+		{
+			opposite.erase(it);
+			return;
+		}
+		if (std::find(to.begin(), to.end(), guid) == to.end())
+		{
+			to.emplace_back(guid);
+		}
+	}
+
+	std::vector<TeamDelta> delta_list_;
+	std::unordered_map<Guid, std::size_t> delta_index_;
+	bool enabled_{ false };
+};
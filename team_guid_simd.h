@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "type_define/type_define.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TEAM_GUID_SIMD_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#define TEAM_GUID_SIMD_TARGET(isa)
+#else
+#include <immintrin.h>
+#define TEAM_GUID_SIMD_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+//build with TEAM_GUID_SIMD_DISABLED to always use the scalar kernels
+
+//packed guid arrays are padded to a whole number of the widest compare, so a kernel never has a scalar tail.
+//a match mask has one bit per guid, padded arrays hold at most kGuidMatchMaxSize guids
+static constexpr std::size_t kGuidLaneSize = 4;
+static constexpr std::size_t kGuidMatchMaxSize = 32;
+
+inline constexpr std::size_t GuidPaddedSize(const std::size_t size)
+{
+	return (size + kGuidLaneSize - 1) / kGuidLaneSize * kGuidLaneSize;
+}
+
+//bits of the first size guids, padding and stale slots past size are masked out with it
+inline constexpr uint32_t GuidSizeMask(const std::size_t size)
+{
+	return static_cast<uint32_t>((uint64_t{ 1 } << size) - 1);
+}
+
+inline std::size_t GuidMatchIndex(const uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return static_cast<std::size_t>(__builtin_ctz(mask));
+#endif
+}
+
+enum class GuidSimdLevel : uint8_t
+{
+	kScalar,
+	kSse42,
+	kAvx2,
+};
+
+//bit i of the result is set when data[i] == guid. padded_size is a multiple of kGuidLaneSize
+using GuidMatchFunc = uint32_t (*)(const Guid* data, std::size_t padded_size, Guid guid);
+//hit_list[i] is 1 when guid_list[i] is one of the first size guids of data, 0 otherwise
+using GuidBatchMatchFunc = void (*)(const Guid* data, std::size_t padded_size, std::size_t size,
+	const Guid* guid_list, std::size_t guid_size, uint8_t* hit_list);
+
+struct GuidSimd
+{
+	GuidSimdLevel level_{ GuidSimdLevel::kScalar };
+	GuidMatchFunc match_{ nullptr };
+	GuidBatchMatchFunc batch_match_{ nullptr };
+};
+
+namespace guid_simd
+{
+	inline uint32_t MatchScalar(const Guid* data, const std::size_t padded_size, const Guid guid)
+	{
+		uint32_t mask = 0;
+		for (std::size_t i = 0; i < padded_size; ++i)
+		{
+			mask |= static_cast<uint32_t>(data[i] == guid) << i;
+		}
+		return mask;
+	}
+
+	inline void BatchMatchScalar(const Guid* data, const std::size_t padded_size, const std::size_t size,
+		const Guid* guid_list, const std::size_t guid_size, uint8_t* hit_list)
+	{
+		const auto size_mask = GuidSizeMask(size);
+		for (std::size_t i = 0; i < guid_size; ++i)
+		{
+			hit_list[i] = 0 != (MatchScalar(data, padded_size, guid_list[i]) & size_mask);
+		}
+	}
+
+#if defined(TEAM_GUID_SIMD_X86)
+	//two guids per compare
+	TEAM_GUID_SIMD_TARGET("sse4.2") inline uint32_t MatchSse42(const Guid* data, const std::size_t padded_size, const Guid guid)
+	{
+		const __m128i key = _mm_set1_epi64x(static_cast<long long>(guid));
+		uint32_t mask = 0;
+		for (std::size_t i = 0; i < padded_size; i += 2)
+		{
+			const __m128i lane = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+			mask |= static_cast<uint32_t>(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(lane, key)))) << i;
+		}
+		return mask;
+	}
+
+	TEAM_GUID_SIMD_TARGET("sse4.2") inline void BatchMatchSse42(const Guid* data, const std::size_t padded_size, const std::size_t size,
+		const Guid* guid_list, const std::size_t guid_size, uint8_t* hit_list)
+	{
+		const auto size_mask = GuidSizeMask(size);
+		for (std::size_t i = 0; i < guid_size; ++i)
+		{
+			hit_list[i] = 0 != (MatchSse42(data, padded_size, guid_list[i]) & size_mask);
+		}
+	}
+
+	//four guids per compare
+	TEAM_GUID_SIMD_TARGET("avx2") inline uint32_t MatchAvx2(const Guid* data, const std::size_t padded_size, const Guid guid)
+	{
+		const __m256i key = _mm256_set1_epi64x(static_cast<long long>(guid));
+		uint32_t mask = 0;
+		for (std::size_t i = 0; i < padded_size; i += 4)
+		{
+			const __m256i lane = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+			mask |= static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(lane, key)))) << i;
+		}
+		return mask;
+	}
+
+	//the member array and its size mask are loaded once, each guid costs one compare per four members
+	TEAM_GUID_SIMD_TARGET("avx2") inline void BatchMatchAvx2(const Guid* data, const std::size_t padded_size, const std::size_t size,
+		const Guid* guid_list, const std::size_t guid_size, uint8_t* hit_list)
+	{
+		static constexpr std::size_t kLaneSize = kGuidMatchMaxSize / 4;
+		__m256i lane_list[kLaneSize];
+		__m256i valid_list[kLaneSize];
+		const auto lane_size = padded_size / 4;
+		const __m256i index = _mm256_set_epi64x(3, 2, 1, 0);
+		for (std::size_t i = 0; i < lane_size; ++i)
+		{
+			lane_list[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i * 4));
+			valid_list[i] = _mm256_cmpgt_epi64(_mm256_set1_epi64x(static_cast<long long>(size - i * 4)), index);
+		}
+		for (std::size_t i = 0; i < guid_size; ++i)
+		{
+			const __m256i key = _mm256_set1_epi64x(static_cast<long long>(guid_list[i]));
+			__m256i hit = _mm256_setzero_si256();
+			for (std::size_t j = 0; j < lane_size; ++j)
+			{
+				hit = _mm256_or_si256(hit, _mm256_and_si256(_mm256_cmpeq_epi64(lane_list[j], key), valid_list[j]));
+			}
+			hit_list[i] = !_mm256_testz_si256(hit, hit);
+		}
+	}
+#endif
+
+	inline GuidSimdLevel DetectLevel()
+	{
+#if defined(TEAM_GUID_SIMD_X86) && !defined(TEAM_GUID_SIMD_DISABLED)
+#if defined(_MSC_VER)
+		int info[4]{};
+		__cpuid(info, 1);
+		const bool sse42 = 0 != (info[2] & (1 << 20));
+		//avx2 also needs the os to save ymm registers
+		const bool avx = 0 != (info[2] & (1 << 27)) && 0 != (info[2] & (1 << 28)) && 0x6 == (_xgetbv(0) & 0x6);
+		__cpuidex(info, 7, 0);
+		const bool avx2 = avx && 0 != (info[1] & (1 << 5));
+#else
+		__builtin_cpu_init();
+		const bool sse42 = __builtin_cpu_supports("sse4.2");
+		const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+		if (avx2)
+		{
+			return GuidSimdLevel::kAvx2;
+		}
+		if (sse42)
+		{
+			return GuidSimdLevel::kSse42;
+		}
+#endif
+		return GuidSimdLevel::kScalar;
+	}
+}
+
+//best level the cpu runs, detected once
+inline GuidSimdLevel GuidSimdSupportedLevel()
+{
+	static const GuidSimdLevel level = guid_simd::DetectLevel();
+	return level;
+}
+
+//kernels of one level, a level the cpu can not run falls back to the best one below it
+inline GuidSimd GuidSimdFor(GuidSimdLevel level)
+{
+	if (level > GuidSimdSupportedLevel())
+	{
+		level = GuidSimdSupportedLevel();
+	}
+	switch (level)
+	{
+#if defined(TEAM_GUID_SIMD_X86)
+	case GuidSimdLevel::kAvx2:
+		return { level, guid_simd::MatchAvx2, guid_simd::BatchMatchAvx2 };
+	case GuidSimdLevel::kSse42:
+		return { level, guid_simd::MatchSse42, guid_simd::BatchMatchSse42 };
+#endif
+	default:
+		return { GuidSimdLevel::kScalar, guid_simd::MatchScalar, guid_simd::BatchMatchScalar };
+	}
+}
+
+//kernels picked at first use for the running cpu
+inline const GuidSimd& guid_simd_kernels()
+{
+	static const GuidSimd simd = GuidSimdFor(GuidSimdSupportedLevel());
+	return simd;
+}
+
+inline uint32_t GuidMatch(const Guid* data, const std::size_t padded_size, const Guid guid)
+{
+	return guid_simd_kernels().match_(data, padded_size, guid);
+}
+
+inline void GuidBatchMatch(const Guid* data, const std::size_t padded_size, const std::size_t size,
+	const Guid* guid_list, const std::size_t guid_size, uint8_t* hit_list)
+{
+	guid_simd_kernels().batch_match_(data, padded_size, size, guid_list, guid_size, hit_list);
+}
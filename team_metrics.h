@@ -0,0 +1,412 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//build with TEAM_METRICS_DISABLED to compile every timer and counter out of TeamSystem
+
+enum class TeamOp : uint8_t
+{
+	kCreateTeam,
+	kCreateTeams,
+	kJoinTeam,
+	kJoinTeamList,
+	kLeaveTeam,
+	kKickMember,
+	kDisbanded,
+	kDisbandedTeamNoLeader,
+	kDisbandTeams,
+	kAppointLeader,
+	kApplyToTeam,
+	kDelApplicant,
+	kWithdrawApplications,
+	kInviteToTeam,
+	kAcceptInvite,
+	kDeclineInvite,
+	kCreateRaid,
+	kAddRaidTeam,
+	kJoinRaid,
+	kMoveRaidMember,
+	kAppointRaidLeader,
+	kDisbandRaid,
+	kMergeTeams,
+	kTransferMembers,
+	kSize,
+};
+
+static constexpr std::size_t kTeamOpSize = static_cast<std::size_t>(TeamOp::kSize);
+
+inline const char* TeamOpName(const TeamOp op)
+{
+	static constexpr const char* kNameList[kTeamOpSize] = { "CreateTeam", "CreateTeams", "JoinTeam", "JoinTeamList", "LeaveTeam",
+		"KickMember", "Disbanded", "DisbandedTeamNoLeader", "DisbandTeams", "AppointLeader", "ApplyToTeam", "DelApplicant",
+		"WithdrawApplications", "InviteToTeam", "AcceptInvite", "DeclineInvite", "CreateRaid", "AddRaidTeam", "JoinRaid",
+		"MoveRaidMember", "AppointRaidLeader", "DisbandRaid", "MergeTeams", "TransferMembers" };
+	return op < TeamOp::kSize ? kNameList[static_cast<std::size_t>(op)] : "";
+}
+
+//log linear latency buckets: values below 8 are exact, above that every power of two has 8 sub buckets,
+//so a bucket is never more than 12.5% wide and all of uint64_t fits in 496 counters
+static constexpr std::size_t kTeamLatencySubBucketBits = 3;
+static constexpr std::size_t kTeamLatencySubBucketSize = std::size_t{ 1 } << kTeamLatencySubBucketBits;
+static constexpr std::size_t kTeamLatencyBucketSize = (64 - kTeamLatencySubBucketBits + 1) * kTeamLatencySubBucketSize;
+//distinct return codes kept per operation, rarer codes only count towards other
+static constexpr std::size_t kTeamRetSlotSize = 16;
+
+inline std::size_t TeamLatencyBucket(const uint64_t value)
+{
+	if (value < kTeamLatencySubBucketSize)
+	{
+		return static_cast<std::size_t>(value);
+	}
+#if defined(_MSC_VER)
+	unsigned long exponent = 0;
+	_BitScanReverse64(&exponent, value);
+#else
+	const auto exponent = static_cast<std::size_t>(63 - __builtin_clzll(value));
+#endif
+	const auto sub_bucket = static_cast<std::size_t>(value >> (exponent - kTeamLatencySubBucketBits)) & (kTeamLatencySubBucketSize - 1);
+	return (exponent - kTeamLatencySubBucketBits + 1) * kTeamLatencySubBucketSize + sub_bucket;
+}
+
+//smallest value that lands in the bucket
+inline uint64_t TeamLatencyBucketValue(const std::size_t bucket)
+{
+	if (bucket < kTeamLatencySubBucketSize)
+	{
+		return bucket;
+	}
+	const auto shift = bucket / kTeamLatencySubBucketSize - 1;
+	return (kTeamLatencySubBucketSize + bucket % kTeamLatencySubBucketSize) << shift;
+}
+
+//tsc ticks on x86, nanoseconds elsewhere. a snapshot converts ticks to nanoseconds
+struct TeamMetricsClock
+{
+	static inline uint64_t Now()
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+	}
+
+	static inline uint64_t SteadyNs()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+};
+
+struct TeamOpSnapshot
+{
+	inline double mean_ns(const double ns_per_tick) const { return 0 == count_ ? 0.0 : static_cast<double>(total_ticks_) * ns_per_tick / static_cast<double>(count_); }
+
+	inline uint64_t ret_count(const uint32_t ret) const
+	{
+		const auto it = ret_count_list_.find(ret);
+		return it == ret_count_list_.end() ? 0 : it->second;
+	}
+
+	//in ticks, the lower edge of the bucket holding the given fraction of samples
+	uint64_t Percentile(const double fraction) const
+	{
+		if (0 == count_)
+		{
+			return 0;
+		}
+		const auto rank = static_cast<uint64_t>(fraction * static_cast<double>(count_ - 1)) + 1;
+		uint64_t seen = 0;
+		for (std::size_t bucket = 0; bucket < latency_list_.size(); ++bucket)
+		{
+			seen += latency_list_[bucket];
+			if (seen >= rank)
+			{
+				return TeamLatencyBucketValue(bucket);
+			}
+		}
+		return max_ticks_;
+	}
+
+	void Merge(const TeamOpSnapshot& rhs)
+	{
+		count_ += rhs.count_;
+		total_ticks_ += rhs.total_ticks_;
+		max_ticks_ = std::max(max_ticks_, rhs.max_ticks_);
+		other_ret_count_ += rhs.other_ret_count_;
+		for (std::size_t bucket = 0; bucket < latency_list_.size(); ++bucket)
+		{
+			latency_list_[bucket] += rhs.latency_list_[bucket];
+		}
+		for (const auto& [ret, count] : rhs.ret_count_list_)
+		{
+			ret_count_list_[ret] += count;
+		}
+	}
+
+	uint64_t count_{ 0 };
+	uint64_t total_ticks_{ 0 };
+	uint64_t max_ticks_{ 0 };
+	uint64_t other_ret_count_{ 0 };
+	std::array<uint64_t, kTeamLatencyBucketSize> latency_list_{};
+	std::unordered_map<uint32_t, uint64_t> ret_count_list_;
+};
+
+struct TeamMetricsSnapshot
+{
+	inline const TeamOpSnapshot& operator[](const TeamOp op) const { return op_list_[static_cast<std::size_t>(op)]; }
+	inline uint64_t PercentileNs(const TeamOp op, const double fraction) const
+	{
+		return static_cast<uint64_t>(static_cast<double>((*this)[op].Percentile(fraction)) * ns_per_tick_);
+	}
+
+	void Merge(const TeamMetricsSnapshot& rhs)
+	{
+		for (std::size_t i = 0; i < kTeamOpSize; ++i)
+		{
+			op_list_[i].Merge(rhs.op_list_[i]);
+		}
+	}
+
+	//one line per operation that ran: name count mean p50 p99 p999 max in ns, then ret=count pairs
+	void Write(std::string& buffer) const
+	{
+		buffer.clear();
+		for (std::size_t i = 0; i < kTeamOpSize; ++i)
+		{
+			const auto op = static_cast<TeamOp>(i);
+			const auto& op_snapshot = op_list_[i];
+			if (0 == op_snapshot.count_)
+			{
+				continue;
+			}
+			buffer.append(TeamOpName(op));
+			buffer.append(" count=").append(std::to_string(op_snapshot.count_));
+			buffer.append(" mean_ns=").append(std::to_string(static_cast<uint64_t>(op_snapshot.mean_ns(ns_per_tick_))));
+			buffer.append(" p50_ns=").append(std::to_string(PercentileNs(op, 0.5)));
+			buffer.append(" p99_ns=").append(std::to_string(PercentileNs(op, 0.99)));
+			buffer.append(" p999_ns=").append(std::to_string(PercentileNs(op, 0.999)));
+			buffer.append(" max_ns=").append(std::to_string(static_cast<uint64_t>(static_cast<double>(op_snapshot.max_ticks_) * ns_per_tick_)));
+			for (const auto& [ret, count] : op_snapshot.ret_count_list_)
+			{
+				buffer.append(" ret_").append(std::to_string(ret)).append("=").append(std::to_string(count));
+			}
+			if (op_snapshot.other_ret_count_ > 0)
+			{
+				buffer.append(" ret_other=").append(std::to_string(op_snapshot.other_ret_count_));
+			}
+			buffer.append("\n");
+		}
+	}
+
+	std::array<TeamOpSnapshot, kTeamOpSize> op_list_;
+	double ns_per_tick_{ 1.0 };
+};
+
+#ifndef TEAM_METRICS_DISABLED
+
+//counters of one thread. only the owning thread writes, so an increment is a relaxed load and store
+//with no locked instruction, and a snapshot from any other thread still reads whole values
+class TeamThreadMetrics
+{
+public:
+	TeamThreadMetrics();
+	~TeamThreadMetrics();
+
+	void Record(const TeamOp op, const uint64_t ticks, const uint32_t ret)
+	{
+		auto& op_metrics = op_list_[static_cast<std::size_t>(op)];
+		Add(op_metrics.count_, 1);
+		Add(op_metrics.total_ticks_, ticks);
+		if (ticks > op_metrics.max_ticks_.load(std::memory_order_relaxed))
+		{
+			op_metrics.max_ticks_.store(ticks, std::memory_order_relaxed);
+		}
+		Add(op_metrics.latency_list_[TeamLatencyBucket(ticks)], 1);
+
+		const auto ret_size = op_metrics.ret_size_.load(std::memory_order_relaxed);
+		for (std::size_t i = 0; i < ret_size; ++i)
+		{
+			if (op_metrics.ret_list_[i] == ret)
+			{
+				Add(op_metrics.ret_count_list_[i], 1);
+				return;
+			}
+		}
+		if (ret_size >= kTeamRetSlotSize)
+		{
+			Add(op_metrics.other_ret_count_, 1);
+			return;
+		}
+		op_metrics.ret_list_[ret_size] = ret;
+		op_metrics.ret_count_list_[ret_size].store(1, std::memory_order_relaxed);
+		op_metrics.ret_size_.store(ret_size + 1, std::memory_order_release);
+	}
+
+	void Collect(TeamMetricsSnapshot& snapshot) const
+	{
+		for (std::size_t i = 0; i < kTeamOpSize; ++i)
+		{
+			const auto& op_metrics = op_list_[i];
+			auto& op_snapshot = snapshot.op_list_[i];
+			op_snapshot.count_ += op_metrics.count_.load(std::memory_order_relaxed);
+			op_snapshot.total_ticks_ += op_metrics.total_ticks_.load(std::memory_order_relaxed);
+			op_snapshot.max_ticks_ = std::max(op_snapshot.max_ticks_, op_metrics.max_ticks_.load(std::memory_order_relaxed));
+			op_snapshot.other_ret_count_ += op_metrics.other_ret_count_.load(std::memory_order_relaxed);
+			for (std::size_t bucket = 0; bucket < kTeamLatencyBucketSize; ++bucket)
+			{
+				op_snapshot.latency_list_[bucket] += op_metrics.latency_list_[bucket].load(std::memory_order_relaxed);
+			}
+			const auto ret_size = op_metrics.ret_size_.load(std::memory_order_acquire);
+			for (std::size_t j = 0; j < ret_size; ++j)
+			{
+				op_snapshot.ret_count_list_[op_metrics.ret_list_[j]] += op_metrics.ret_count_list_[j].load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+private:
+	struct OpMetrics
+	{
+		std::atomic<uint64_t> count_{ 0 };
+		std::atomic<uint64_t> total_ticks_{ 0 };
+		std::atomic<uint64_t> max_ticks_{ 0 };
+		std::atomic<uint64_t> other_ret_count_{ 0 };
+		std::array<std::atomic<uint64_t>, kTeamLatencyBucketSize> latency_list_{};
+		std::atomic<std::size_t> ret_size_{ 0 };
+		uint32_t ret_list_[kTeamRetSlotSize]{};
+		std::array<std::atomic<uint64_t>, kTeamRetSlotSize> ret_count_list_{};
+	};
+
+	static inline void Add(std::atomic<uint64_t>& counter, const uint64_t value)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	std::array<OpMetrics, kTeamOpSize> op_list_;
+};
+
+class TeamMetrics
+{
+public:
+	static inline TeamThreadMetrics& thread_metrics()
+	{
+		thread_local TeamThreadMetrics thread_metrics;
+		return thread_metrics;
+	}
+
+	//merges every live thread and every thread that already exited
+	static TeamMetricsSnapshot Snapshot()
+	{
+		auto& registry = GetRegistry();
+		TeamMetricsSnapshot snapshot;
+		{
+			std::lock_guard lock(registry.mutex_);
+			snapshot.Merge(registry.exited_);
+			for (const auto* thread_metrics : registry.thread_list_)
+			{
+				thread_metrics->Collect(snapshot);
+			}
+		}
+		snapshot.ns_per_tick_ = NsPerTick(registry);
+		return snapshot;
+	}
+
+private:
+	friend class TeamThreadMetrics;
+
+	struct Registry
+	{
+		std::mutex mutex_;
+		std::vector<const TeamThreadMetrics*> thread_list_;
+		TeamMetricsSnapshot exited_;
+		uint64_t anchor_ticks_{ TeamMetricsClock::Now() };
+		uint64_t anchor_ns_{ TeamMetricsClock::SteadyNs() };
+	};
+
+	static Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	//the tick rate is measured against steady_clock since the first thread registered
+	static double NsPerTick(const Registry& registry)
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		if (TeamMetricsClock::SteadyNs() - registry.anchor_ns_ < 1000000)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+		const auto ticks = TeamMetricsClock::Now() - registry.anchor_ticks_;
+		const auto ns = TeamMetricsClock::SteadyNs() - registry.anchor_ns_;
+		return 0 == ticks ? 1.0 : static_cast<double>(ns) / static_cast<double>(ticks);
+#else
+		(void)registry;
+		return 1.0;
+#endif
+	}
+};
+
+inline TeamThreadMetrics::TeamThreadMetrics()
+{
+	auto& registry = TeamMetrics::GetRegistry();
+	std::lock_guard lock(registry.mutex_);
+	registry.thread_list_.push_back(this);
+}
+
+inline TeamThreadMetrics::~TeamThreadMetrics()
+{
+	auto& registry = TeamMetrics::GetRegistry();
+	std::lock_guard lock(registry.mutex_);
+	Collect(registry.exited_);
+	registry.thread_list_.erase(std::find(registry.thread_list_.begin(), registry.thread_list_.end(), this));
+}
+
+//times one TeamSystem operation, the return code is recorded together with the latency
+class TeamOpTimer
+{
+public:
+	explicit TeamOpTimer(const TeamOp op) : op_(op), start_(TeamMetricsClock::Now()) {}
+
+	inline uint32_t Record(const uint32_t ret) const
+	{
+		TeamMetrics::thread_metrics().Record(op_, TeamMetricsClock::Now() - start_, ret);
+		return ret;
+	}
+
+private:
+	TeamOp op_;
+	uint64_t start_{ 0 };
+};
+
+#else
+
+class TeamMetrics
+{
+public:
+	static TeamMetricsSnapshot Snapshot() { return {}; }
+};
+
+class TeamOpTimer
+{
+public:
+	explicit TeamOpTimer(const TeamOp) {}
+	inline uint32_t Record(const uint32_t ret) const { return ret; }
+};
+
+#endif
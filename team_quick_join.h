@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "teams/team_system.h"
+
+//solo players waiting in a quick join queue need at least this many to open a new team together
+static constexpr std::size_t kQuickJoinMinTeamSize = 2;
+
+struct QuickJoinPlacement
+{
+	Guid guid_{ kInvalidGuid };
+	Guid team_id_{ kInvalidGuid };
+};
+
+using QuickJoinPlacementVector = std::vector<QuickJoinPlacement>;
+
+//solo queue per team type. every tick the queue first fills open teams of that type, fewest free slots first,
+//then batches whoever is left into new teams with one CreateTeams call, cut down to the room left in the registry
+class TeamQuickJoin
+{
+public:
+	explicit TeamQuickJoin(TeamSystem& team_system) : team_system_(team_system) {}
+
+	inline std::size_t size() const { return ticket_list_.size(); }
+	inline bool IsQueued(const Guid guid) const { return ticket_list_.find(guid) != ticket_list_.end(); }
+	//teams a tick could have formed but left for later because the team registry was full
+	inline uint64_t registry_full_size() const { return registry_full_size_; }
+
+	uint32_t Enqueue(const Guid guid, const std::size_t team_type_size)
+	{
+		if (team_type_size < kQuickJoinMinTeamSize || !TeamSystem::IsTeamType(team_type_size))
+		{
+			return kRetTeamCreateTeamMaxMemberSize;
+		}
+		const auto player = TeamSystem::GetPlayer(guid);
+		if (entt::null == player)
+		{
+			return kRetTeamPlayerNotFound;
+		}
+		if (TeamSystem::HasTeam(player))
+		{
+			return kRetTeamMemberInTeam;
+		}
+		if (IsQueued(guid))
+		{
+			return kOK;
+		}
+		const Ticket ticket{ guid, ++sequence_ };
+		ticket_list_.emplace(guid, ticket.sequence_);
+		queue_list_[team_type_size].emplace_back(ticket);
+		return kOK;
+	}
+
+	//the queue entry is skipped lazily on the next tick
+	void Dequeue(const Guid guid) { ticket_list_.erase(guid); }
+
+	//placed players leave the queue and are appended to placement_list
+	void Tick(QuickJoinPlacementVector& placement_list)
+	{
+		for (std::size_t team_type_size = kQuickJoinMinTeamSize; team_type_size < std::size(queue_list_); ++team_type_size)
+		{
+			Match(team_type_size, placement_list);
+		}
+	}
+
+private:
+	struct Ticket
+	{
+		Guid guid_{ kInvalidGuid };
+		uint64_t sequence_{ 0 };
+	};
+
+	using TicketVector = std::vector<Ticket>;
+
+	void Match(const std::size_t team_type_size, QuickJoinPlacementVector& placement_list)
+	{
+		auto& queue = queue_list_[team_type_size];
+		waiting_.clear();
+		for (const auto& ticket : queue)
+		{
+			const auto ticket_it = ticket_list_.find(ticket.guid_);
+			if (ticket_it == ticket_list_.end() || ticket_it->second != ticket.sequence_)
+			{
+				continue;
+			}
+			//logged out or joined a team some other way while waiting
+			const auto player = TeamSystem::GetPlayer(ticket.guid_);
+			if (entt::null == player || TeamSystem::HasTeam(player))
+			{
+				ticket_list_.erase(ticket_it);
+				continue;
+			}
+			waiting_.emplace_back(ticket);
+		}
+		queue.clear();
+		if (waiting_.empty())
+		{
+			return;
+		}
+
+		std::size_t next = 0;
+		FillOpenTeams(team_type_size, next, queue, placement_list);
+		CreateTeams(team_type_size, next, queue, placement_list);
+		queue.insert(queue.end(), waiting_.begin() + static_cast<std::ptrdiff_t>(next), waiting_.end());
+	}
+
+	void FillOpenTeams(const std::size_t team_type_size, std::size_t& next, TicketVector& queue, QuickJoinPlacementVector& placement_list)
+	{
+		//the open team list is taken up front, joining moves teams between browse buckets
+		team_id_list_.clear();
+		TeamBrowseCursor cursor;
+		std::size_t free_slots = 0;
+		while (free_slots < waiting_.size() && !cursor.finished())
+		{
+			const auto first = team_id_list_.size();
+			TeamSystem::open_team_index().Find(1, team_type_size, waiting_.size(), team_id_list_, cursor);
+			for (auto i = first; i < team_id_list_.size(); ++i)
+			{
+				free_slots += team_type_size - TeamSystem::member_size(team_id_list_[i]);
+			}
+		}
+		for (const auto& team_id : team_id_list_)
+		{
+			if (next >= waiting_.size())
+			{
+				return;
+			}
+			const auto free = team_type_size - TeamSystem::member_size(team_id);
+			UInt64Set member_list;
+			for (std::size_t i = 0; i < free && next + i < waiting_.size(); ++i)
+			{
+				member_list.emplace(waiting_[next + i].guid_);
+			}
+			if (kOK != TeamSystem::JoinTeam(member_list, team_id))
+			{
+				continue;
+			}
+			for (std::size_t i = 0; i < member_list.size(); ++i, ++next)
+			{
+				Place(waiting_[next], team_id, queue, placement_list);
+			}
+		}
+	}
+
+	void CreateTeams(const std::size_t team_type_size, std::size_t& next, TicketVector& queue, QuickJoinPlacementVector& placement_list)
+	{
+		std::vector<CreateTeamP> param_list;
+		const auto team_room = kMaxTeamSize - std::min(TeamSystem::team_size(), kMaxTeamSize);
+		for (auto first = next; first + kQuickJoinMinTeamSize <= waiting_.size(); first += team_type_size)
+		{
+			if (param_list.size() >= team_room)
+			{
+				++registry_full_size_;
+				continue;
+			}
+			const auto last = std::min(first + team_type_size, waiting_.size());
+			UInt64Set member_list;
+			for (auto i = first; i < last; ++i)
+			{
+				member_list.emplace(waiting_[i].guid_);
+			}
+			param_list.push_back({ waiting_[first].guid_, member_list, team_type_size });
+		}
+		if (param_list.empty())
+		{
+			return;
+		}
+		//all or nothing, on failure everyone stays queued for the next tick
+		GuidVector new_team_id_list;
+		if (kOK != team_system_.CreateTeams(param_list, new_team_id_list))
+		{
+			return;
+		}
+		for (std::size_t i = 0; i < param_list.size(); ++i)
+		{
+			for (std::size_t j = 0; j < param_list[i].member_list.size(); ++j, ++next)
+			{
+				Place(waiting_[next], new_team_id_list[i], queue, placement_list);
+			}
+		}
+	}
+
+	//only a player the team really holds is placed, anyone else waits for the next tick
+	void Place(const Ticket& ticket, const Guid team_id, TicketVector& queue, QuickJoinPlacementVector& placement_list)
+	{
+		if (!TeamSystem::HasMember(team_id, ticket.guid_))
+		{
+			queue.emplace_back(ticket);
+			return;
+		}
+		ticket_list_.erase(ticket.guid_);
+		placement_list.push_back({ ticket.guid_, team_id });
+	}
+
+	TeamSystem& team_system_;
+	std::unordered_map<Guid, uint64_t> ticket_list_;
+	TicketVector queue_list_[kTenMemberMaxSize + 1];
+	TicketVector waiting_;
+	GuidVector team_id_list_;
+	uint64_t sequence_{ 0 };
+	uint64_t registry_full_size_{ 0 };
+};
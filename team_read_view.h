@@ -0,0 +1,457 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "teams/team_delta_journal.h"
+#include "teams/team_system.h"
+
+struct TeamReadRecord
+{
+	Guid key_{ kInvalidGuid };
+	Guid leader_id_{ kInvalidGuid };
+	TeamMemberVector members_;
+};
+
+struct PlayerTeamReadRecord
+{
+	Guid key_{ kInvalidGuid };
+	Guid team_id_{ kInvalidGuid };
+};
+
+//open addressing table of immutable records, written by one thread, read by any thread.
+//a slot only ever holds null, the tombstone or a whole record, so readers never see a torn entry.
+//once live records and tombstones pass three quarters of the slots the writer copies the live records
+//into a new slot array, grown while they fill more than half of it, and publishes that instead
+template <typename Record>
+class RcuGuidTable
+{
+public:
+	struct Slots
+	{
+		explicit Slots(const std::size_t capacity) : mask_(capacity - 1), slot_list_(std::make_unique<std::atomic<const Record*>[]>(capacity))
+		{
+			for (std::size_t i = 0; i < capacity; ++i)
+			{
+				slot_list_[i].store(nullptr, std::memory_order_relaxed);
+			}
+		}
+
+		inline std::size_t capacity() const { return mask_ + 1; }
+
+		std::size_t mask_{ 0 };
+		std::unique_ptr<std::atomic<const Record*>[]> slot_list_;
+	};
+
+	explicit RcuGuidTable(const std::size_t capacity) : slots_(new Slots(capacity)) {}
+
+	~RcuGuidTable()
+	{
+		const auto* slots = slots_.load(std::memory_order_relaxed);
+		for (std::size_t i = 0; i <= slots->mask_; ++i)
+		{
+			if (const auto* record = slots->slot_list_[i].load(std::memory_order_relaxed); nullptr != record && Tombstone() != record)
+			{
+				delete record;
+			}
+		}
+		delete slots;
+	}
+
+	RcuGuidTable(const RcuGuidTable&) = delete;
+	RcuGuidTable& operator=(const RcuGuidTable&) = delete;
+
+	inline std::size_t size() const { return live_size_; }
+	inline std::size_t capacity() const { return slots_.load(std::memory_order_relaxed)->capacity(); }
+
+	const Record* Find(const Guid key) const
+	{
+		const auto& slots = *slots_.load(std::memory_order_acquire);
+		for (std::size_t i = 0, slot = Hash(key, slots.mask_); i <= slots.mask_; ++i, slot = (slot + 1) & slots.mask_)
+		{
+			const auto* record = slots.slot_list_[slot].load(std::memory_order_acquire);
+			if (nullptr == record)
+			{
+				return nullptr;
+			}
+			if (Tombstone() != record && record->key_ == key)
+			{
+				return record;
+			}
+		}
+		return nullptr;
+	}
+
+	//writer only, call before Upsert. rebuilds when one more record would pass the load factor
+	//and returns the replaced slot array for retirement, the records themselves move over
+	const Slots* Reserve()
+	{
+		const auto* slots = slots_.load(std::memory_order_relaxed);
+		if ((used_size_ + 1) * 4 <= slots->capacity() * 3)
+		{
+			return nullptr;
+		}
+		auto capacity = slots->capacity();
+		while ((live_size_ + 1) * 2 > capacity)
+		{
+			capacity *= 2;
+		}
+		auto* new_slots = new Slots(capacity);
+		for (std::size_t i = 0; i <= slots->mask_; ++i)
+		{
+			const auto* record = slots->slot_list_[i].load(std::memory_order_relaxed);
+			if (nullptr == record || Tombstone() == record)
+			{
+				continue;
+			}
+			auto slot = Hash(record->key_, new_slots->mask_);
+			while (nullptr != new_slots->slot_list_[slot].load(std::memory_order_relaxed))
+			{
+				slot = (slot + 1) & new_slots->mask_;
+			}
+			new_slots->slot_list_[slot].store(record, std::memory_order_relaxed);
+		}
+		used_size_ = live_size_;
+		slots_.store(new_slots, std::memory_order_release);
+		return slots;
+	}
+
+	//writer only, returns the replaced record for retirement
+	const Record* Upsert(const Record* new_record)
+	{
+		auto& slots = *slots_.load(std::memory_order_relaxed);
+		std::size_t free_slot = slots.mask_ + 1;
+		for (std::size_t i = 0, slot = Hash(new_record->key_, slots.mask_); i <= slots.mask_; ++i, slot = (slot + 1) & slots.mask_)
+		{
+			const auto* record = slots.slot_list_[slot].load(std::memory_order_relaxed);
+			if (nullptr == record)
+			{
+				if (free_slot > slots.mask_)
+				{
+					free_slot = slot;
+					++used_size_;
+				}
+				break;
+			}
+			if (Tombstone() == record)
+			{
+				if (free_slot > slots.mask_)
+				{
+					free_slot = slot;
+				}
+				continue;
+			}
+			if (record->key_ == new_record->key_)
+			{
+				slots.slot_list_[slot].store(new_record, std::memory_order_release);
+				return record;
+			}
+		}
+		++live_size_;
+		slots.slot_list_[free_slot].store(new_record, std::memory_order_release);
+		return nullptr;
+	}
+
+	//writer only, returns the removed record for retirement
+	const Record* Erase(const Guid key)
+	{
+		auto& slots = *slots_.load(std::memory_order_relaxed);
+		for (std::size_t i = 0, slot = Hash(key, slots.mask_); i <= slots.mask_; ++i, slot = (slot + 1) & slots.mask_)
+		{
+			const auto* record = slots.slot_list_[slot].load(std::memory_order_relaxed);
+			if (nullptr == record)
+			{
+				return nullptr;
+			}
+			if (Tombstone() != record && record->key_ == key)
+			{
+				slots.slot_list_[slot].store(Tombstone(), std::memory_order_release);
+				--live_size_;
+				return record;
+			}
+		}
+		return nullptr;
+	}
+
+private:
+	static const Record* Tombstone()
+	{
+		static const Record tombstone;
+		return &tombstone;
+	}
+
+	static inline std::size_t Hash(const Guid key, const std::size_t mask) { return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask; }
+
+	std::atomic<Slots*> slots_;
+	std::size_t live_size_{ 0 };
+	//live records and tombstones, a probe only stops at a null slot
+	std::size_t used_size_{ 0 };
+};
+
+static constexpr std::size_t kTeamReadViewReaderSlotSize = 64;
+
+//read only view of player to team and team to leader and members for other threads.
+//the owning thread feeds it the flushed TeamDeltaJournal each tick; readers are lock free,
+//a reader only retries its entry when the owning thread flips the reclaim epoch under it.
+//replaced records are freed once no reader that could still see them is active.
+//teams that already exist are published when the view is created, on the owning thread
+class TeamReadView
+{
+public:
+	explicit TeamReadView(const std::size_t player_capacity = 1 << 17, const std::size_t team_capacity = 1 << 15)
+		: players_(player_capacity), teams_(team_capacity)
+	{
+		for (const auto team_entity : tls.registry.storage<Team>())
+		{
+			TeamDelta delta;
+			delta.team_id_ = entt::to_integral(team_entity);
+			Apply(delta);
+		}
+	}
+
+	~TeamReadView()
+	{
+		FreeRetired(pending_);
+		FreeRetired(retired_);
+	}
+
+	TeamReadView(const TeamReadView&) = delete;
+	TeamReadView& operator=(const TeamReadView&) = delete;
+
+	inline std::size_t player_size() const { return players_.size(); }
+	inline std::size_t team_size() const { return teams_.size(); }
+
+	//any thread
+	Guid GetTeamId(const Guid guid) const
+	{
+		const ReadGuard guard(*this);
+		const auto* record = players_.Find(guid);
+		return nullptr == record ? kInvalidGuid : record->team_id_;
+	}
+
+	Guid GetLeaderId(const Guid team_id) const
+	{
+		const ReadGuard guard(*this);
+		const auto* record = teams_.Find(team_id);
+		return nullptr == record ? kInvalidGuid : record->leader_id_;
+	}
+
+	Guid GetLeaderIdByPlayerId(const Guid guid) const
+	{
+		const ReadGuard guard(*this);
+		const auto* player = players_.Find(guid);
+		if (nullptr == player)
+		{
+			return kInvalidGuid;
+		}
+		const auto* record = teams_.Find(player->team_id_);
+		return nullptr == record ? kInvalidGuid : record->leader_id_;
+	}
+
+	bool HasMember(const Guid team_id, const Guid guid) const
+	{
+		const ReadGuard guard(*this);
+		const auto* record = teams_.Find(team_id);
+		return nullptr != record && record->members_.contains(guid);
+	}
+
+	bool GetTeam(const Guid team_id, TeamReadRecord& team) const
+	{
+		const ReadGuard guard(*this);
+		const auto* record = teams_.Find(team_id);
+		if (nullptr == record)
+		{
+			return false;
+		}
+		team = *record;
+		return true;
+	}
+
+	//owning thread, republishes the team and its members from the current registry state
+	void Apply(const TeamDelta& delta)
+	{
+		const auto* old_team = teams_.Find(delta.team_id_);
+		const TeamHandle team(delta.team_id_);
+		if (team)
+		{
+			Retire(teams_.Reserve());
+			Retire(teams_.Upsert(new TeamReadRecord{ delta.team_id_, team->leader_id(), team->members_ }));
+			for (const auto& member_it : team->members_)
+			{
+				SyncPlayer(member_it);
+			}
+		}
+		else
+		{
+			Retire(teams_.Erase(delta.team_id_));
+		}
+		if (nullptr != old_team)
+		{
+			for (const auto& member_it : old_team->members_)
+			{
+				SyncPlayer(member_it);
+			}
+		}
+		for (const auto& member_it : delta.del_members_)
+		{
+			SyncPlayer(member_it);
+		}
+	}
+
+	//owning thread, call after the tick's deltas are applied
+	void Reclaim()
+	{
+		if (!pending_.empty())
+		{
+			if (!Drained(pending_parity_))
+			{
+				return;
+			}
+			FreeRetired(pending_);
+		}
+		if (retired_.empty())
+		{
+			return;
+		}
+		pending_.swap(retired_);
+		pending_parity_ = epoch_.fetch_add(1, std::memory_order_seq_cst) & 1;
+		if (Drained(pending_parity_))
+		{
+			FreeRetired(pending_);
+		}
+	}
+
+private:
+	struct alignas(64) ReaderSlot
+	{
+		std::atomic<uint64_t> active_[2]{ 0, 0 };
+	};
+
+	class ReadGuard
+	{
+	public:
+		//the epoch can flip between the load and the increment, then Reclaim already checked the other parity
+		//and could free what this reader is about to see, so the reader only counts once the parity still holds
+		explicit ReadGuard(const TeamReadView& view)
+			: slot_(view.reader_slots_[ReaderSlotIndex()]), parity_(view.epoch_.load(std::memory_order_seq_cst) & 1)
+		{
+			for (;;)
+			{
+				slot_.active_[parity_].fetch_add(1, std::memory_order_seq_cst);
+				const auto parity = view.epoch_.load(std::memory_order_seq_cst) & 1;
+				if (parity == parity_)
+				{
+					break;
+				}
+				slot_.active_[parity_].fetch_sub(1, std::memory_order_release);
+				parity_ = parity;
+			}
+		}
+		~ReadGuard() { slot_.active_[parity_].fetch_sub(1, std::memory_order_release); }
+
+	private:
+		ReaderSlot& slot_;
+		uint64_t parity_{ 0 };
+	};
+
+	using TeamSlots = RcuGuidTable<TeamReadRecord>::Slots;
+	using PlayerSlots = RcuGuidTable<PlayerTeamReadRecord>::Slots;
+
+	struct RetiredRecord
+	{
+		const TeamReadRecord* team_{ nullptr };
+		const PlayerTeamReadRecord* player_{ nullptr };
+		const TeamSlots* team_slots_{ nullptr };
+		const PlayerSlots* player_slots_{ nullptr };
+	};
+	using RetiredList = std::vector<RetiredRecord>;
+
+	static std::size_t ReaderSlotIndex()
+	{
+		static std::atomic<std::size_t> next_index{ 0 };
+		thread_local const std::size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % kTeamReadViewReaderSlotSize;
+		return index;
+	}
+
+	bool Drained(const uint64_t parity) const
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		for (const auto& slot : reader_slots_)
+		{
+			if (slot.active_[parity].load(std::memory_order_acquire) != 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void SyncPlayer(const Guid guid)
+	{
+		const Guid team_id = TeamSystem::HasTeam(guid) ? TeamSystem::GetTeamId(guid) : kInvalidGuid;
+		if (kInvalidGuid == team_id)
+		{
+			Retire(players_.Erase(guid));
+			return;
+		}
+		if (const auto* record = players_.Find(guid); nullptr != record && record->team_id_ == team_id)
+		{
+			return;
+		}
+		Retire(players_.Reserve());
+		Retire(players_.Upsert(new PlayerTeamReadRecord{ guid, team_id }));
+	}
+
+	void Retire(const TeamReadRecord* record)
+	{
+		if (nullptr != record)
+		{
+			retired_.push_back({ record, nullptr, nullptr, nullptr });
+		}
+	}
+
+	void Retire(const PlayerTeamReadRecord* record)
+	{
+		if (nullptr != record)
+		{
+			retired_.push_back({ nullptr, record, nullptr, nullptr });
+		}
+	}
+
+	void Retire(const TeamSlots* slots)
+	{
+		if (nullptr != slots)
+		{
+			retired_.push_back({ nullptr, nullptr, slots, nullptr });
+		}
+	}
+
+	void Retire(const PlayerSlots* slots)
+	{
+		if (nullptr != slots)
+		{
+			retired_.push_back({ nullptr, nullptr, nullptr, slots });
+		}
+	}
+
+	static void FreeRetired(RetiredList& retired_list)
+	{
+		for (const auto& retired : retired_list)
+		{
+			delete retired.team_;
+			delete retired.player_;
+			delete retired.team_slots_;
+			delete retired.player_slots_;
+		}
+		retired_list.clear();
+	}
+
+	RcuGuidTable<PlayerTeamReadRecord> players_;
+	RcuGuidTable<TeamReadRecord> teams_;
+	mutable ReaderSlot reader_slots_[kTeamReadViewReaderSlotSize];
+	std::atomic<uint64_t> epoch_{ 0 };
+	RetiredList retired_;
+	RetiredList pending_;
+	uint64_t pending_parity_{ 0 };
+};
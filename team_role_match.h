@@ -0,0 +1,344 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "teams/team_system.h"
+
+enum TeamRole : uint8_t
+{
+	kTeamRoleTank = 1 << 0,
+	kTeamRoleHealer = 1 << 1,
+	kTeamRoleDps = 1 << 2,
+};
+
+static constexpr std::size_t kTeamRoleSize = 3;
+static constexpr uint8_t kTeamRoleAll = kTeamRoleTank | kTeamRoleHealer | kTeamRoleDps;
+
+//slots per role, indexed by role bit position: tank, healer, dps
+using TeamRoleCount = std::array<std::size_t, kTeamRoleSize>;
+
+//queued with every role the player can play, matched with the one role the player was given
+struct TeamRoleMember
+{
+	Guid guid_{ kInvalidGuid };
+	uint8_t role_mask_{ 0 };
+};
+
+using TeamRoleMemberVector = InlineVector<TeamRoleMember, kTenMemberMaxSize>;
+
+struct TeamRoleMatch
+{
+	Guid team_id_{ kInvalidGuid };
+	TeamRoleMemberVector member_list_;
+};
+
+using TeamRoleMatchVector = std::vector<TeamRoleMatch>;
+
+//fixed composition queue. solos wait in one bucket per role mask, a slot is filled from the buckets
+//whose mask has the role bit, least flexible players first, so no combination is ever searched.
+//when a role runs dry one earlier pick whose mask covers it can swap over, and its old role is picked again.
+//parties get their roles at enqueue and only wait for solos to fill the slots they leave open
+class TeamRoleMatcher
+{
+public:
+	TeamRoleMatcher(TeamSystem& team_system, const TeamRoleCount& composition) : team_system_(team_system), composition_(composition)
+	{
+		for (std::size_t role = 0; role < kTeamRoleSize; ++role)
+		{
+			if (composition_[role] > 0)
+			{
+				composition_mask_ |= static_cast<uint8_t>(1 << role);
+			}
+			auto& bucket_order = bucket_order_list_[role];
+			for (std::size_t flexibility = 1; flexibility <= kTeamRoleSize; ++flexibility)
+			{
+				for (uint8_t mask = 1; mask <= kTeamRoleAll; ++mask)
+				{
+					if ((mask & (1 << role)) && RoleSize(mask) == flexibility)
+					{
+						bucket_order.emplace_back(mask);
+					}
+				}
+			}
+		}
+	}
+
+	inline std::size_t team_type_size() const { return composition_[0] + composition_[1] + composition_[2]; }
+	inline std::size_t size() const { return ticket_list_.size(); }
+	inline std::size_t party_size() const { return party_list_.size(); }
+	inline bool IsQueued(const Guid guid) const { return ticket_list_.find(guid) != ticket_list_.end(); }
+
+	//a solo is a party of one, the leader has to be one of the members. a player can only be queued once
+	uint32_t Enqueue(const Guid leader_id, const TeamRoleMemberVector& member_list)
+	{
+		if (!TeamSystem::IsTeamType(team_type_size()) || member_list.empty() || member_list.size() > team_type_size())
+		{
+			return kRetTeamCreateTeamMaxMemberSize;
+		}
+		bool has_leader = false;
+		for (const auto& member_it : member_list)
+		{
+			const auto player = TeamSystem::GetPlayer(member_it.guid_);
+			if (entt::null == player)
+			{
+				return kRetTeamPlayerNotFound;
+			}
+			const auto same_guid = [&member_it](const TeamRoleMember& rhs) { return rhs.guid_ == member_it.guid_; };
+			if (TeamSystem::HasTeam(player) || IsQueued(member_it.guid_) || std::count_if(member_list.begin(), member_list.end(), same_guid) > 1)
+			{
+				return kRetTeamMemberInTeam;
+			}
+			if (0 == (member_it.role_mask_ & composition_mask_))
+			{
+				return kRetTeamCreateTeamMaxMemberSize;
+			}
+			has_leader = has_leader || member_it.guid_ == leader_id;
+		}
+		if (!has_leader)
+		{
+			return kRetTeamMemberNotInTeam;
+		}
+
+		const auto sequence = ++sequence_;
+		if (1 == member_list.size())
+		{
+			const auto role_mask = static_cast<uint8_t>(member_list.front().role_mask_ & composition_mask_);
+			bucket_list_[role_mask].push_back({ leader_id, sequence });
+			ticket_list_.emplace(leader_id, sequence);
+			return kOK;
+		}
+		Party party{ leader_id, sequence, member_list, composition_ };
+		if (!AssignRoles(party.member_list_, party.need_))
+		{
+			return kRetTeamCreateTeamMaxMemberSize;
+		}
+		for (const auto& member_it : member_list)
+		{
+			ticket_list_.emplace(member_it.guid_, sequence);
+		}
+		party_list_.emplace_back(party);
+		return kOK;
+	}
+
+	//a party is dropped as a whole on the next tick when any member leaves the queue
+	void Dequeue(const Guid guid) { ticket_list_.erase(guid); }
+
+	//every complete team is created with CreateTeam and appended to match_list with the role each member got
+	void Tick(TeamRoleMatchVector& match_list)
+	{
+		std::size_t kept = 0;
+		bool list_max = false;
+		for (std::size_t i = 0; i < party_list_.size(); ++i)
+		{
+			auto& party = party_list_[i];
+			if (!IsValid(party))
+			{
+				for (const auto& member_it : party.member_list_)
+				{
+					if (const auto ticket_it = ticket_list_.find(member_it.guid_); ticket_it != ticket_list_.end() && ticket_it->second == party.sequence_)
+					{
+						ticket_list_.erase(ticket_it);
+					}
+				}
+				continue;
+			}
+			auto member_list = party.member_list_;
+			if (list_max || !Fill(party.need_, member_list) || !Commit(party.leader_id_, member_list, match_list))
+			{
+				list_max = list_max || TeamSystem::IsTeamListMax();
+				party_list_[kept++] = party;
+			}
+		}
+		party_list_.resize(kept);
+
+		while (!list_max)
+		{
+			TeamRoleMemberVector member_list;
+			if (!Fill(composition_, member_list) || !Commit(member_list.front().guid_, member_list, match_list))
+			{
+				return;
+			}
+		}
+	}
+
+private:
+	struct Ticket
+	{
+		Guid guid_{ kInvalidGuid };
+		uint64_t sequence_{ 0 };
+	};
+
+	struct Party
+	{
+		Guid leader_id_{ kInvalidGuid };
+		uint64_t sequence_{ 0 };
+		TeamRoleMemberVector member_list_;
+		TeamRoleCount need_{};
+	};
+
+	static constexpr std::size_t kBucketSize = kTeamRoleAll + 1;
+
+	static inline std::size_t RoleSize(const uint8_t mask) { return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1); }
+
+	//least flexible members pick first, need is left with the slots still open
+	static bool AssignRoles(TeamRoleMemberVector& member_list, TeamRoleCount& need)
+	{
+		for (std::size_t flexibility = 1; flexibility <= kTeamRoleSize; ++flexibility)
+		{
+			for (auto& member_it : member_list)
+			{
+				if (RoleSize(member_it.role_mask_ & kTeamRoleAll) != flexibility)
+				{
+					continue;
+				}
+				bool assigned = false;
+				for (std::size_t role = 0; role < kTeamRoleSize && !assigned; ++role)
+				{
+					if ((member_it.role_mask_ & (1 << role)) && need[role] > 0)
+					{
+						--need[role];
+						member_it.role_mask_ = static_cast<uint8_t>(1 << role);
+						assigned = true;
+					}
+				}
+				if (!assigned)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool IsValid(const Ticket& ticket)
+	{
+		const auto ticket_it = ticket_list_.find(ticket.guid_);
+		if (ticket_it == ticket_list_.end() || ticket_it->second != ticket.sequence_)
+		{
+			return false;
+		}
+		//logged out or got a team some other way while waiting
+		const auto player = TeamSystem::GetPlayer(ticket.guid_);
+		if (entt::null == player || TeamSystem::HasTeam(player))
+		{
+			ticket_list_.erase(ticket_it);
+			return false;
+		}
+		return true;
+	}
+
+	bool IsValid(const Party& party)
+	{
+		for (const auto& member_it : party.member_list_)
+		{
+			if (!IsValid(Ticket{ member_it.guid_, party.sequence_ }))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//tentative, buckets only move once the team is created
+	bool Fill(const TeamRoleCount& need, TeamRoleMemberVector& member_list)
+	{
+		scan_list_.fill(0);
+		//party members keep the roles they were given at enqueue
+		pick_mask_list_.fill(0);
+		for (std::size_t role = 0; role < kTeamRoleSize; ++role)
+		{
+			for (std::size_t i = 0; i < need[role]; ++i)
+			{
+				if (!Pick(role, member_list) && !Swap(role, member_list))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool Pick(const std::size_t role, TeamRoleMemberVector& member_list)
+	{
+		for (const auto mask : bucket_order_list_[role])
+		{
+			const auto& bucket = bucket_list_[mask];
+			auto& scan = scan_list_[mask];
+			while (scan < bucket.size())
+			{
+				const auto& ticket = bucket[scan++];
+				if (IsValid(ticket))
+				{
+					pick_mask_list_[member_list.size()] = mask;
+					member_list.emplace_back({ ticket.guid_, static_cast<uint8_t>(1 << role) });
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	//one step only: an earlier pick that can also play role takes it, and whoever is left in the queue
+	//takes the role it gave up
+	bool Swap(const std::size_t role, TeamRoleMemberVector& member_list)
+	{
+		const auto role_bit = static_cast<uint8_t>(1 << role);
+		const auto picked_size = member_list.size();
+		for (std::size_t i = 0; i < picked_size; ++i)
+		{
+			auto& member_it = member_list[i];
+			if (0 == (pick_mask_list_[i] & role_bit) || member_it.role_mask_ == role_bit)
+			{
+				continue;
+			}
+			const auto old_role_bit = member_it.role_mask_;
+			member_it.role_mask_ = role_bit;
+			if (Pick(static_cast<std::size_t>(std::countr_zero(old_role_bit)), member_list))
+			{
+				return true;
+			}
+			member_it.role_mask_ = old_role_bit;
+		}
+		return false;
+	}
+
+	bool Commit(const Guid leader_id, const TeamRoleMemberVector& member_list, TeamRoleMatchVector& match_list)
+	{
+		UInt64Set guid_list;
+		for (const auto& member_it : member_list)
+		{
+			guid_list.emplace(member_it.guid_);
+		}
+		if (kOK != team_system_.CreateTeam({ leader_id, guid_list, team_type_size() }))
+		{
+			return false;
+		}
+		//everything scanned was either picked or stale
+		for (std::size_t mask = 1; mask < kBucketSize; ++mask)
+		{
+			auto& bucket = bucket_list_[mask];
+			bucket.erase(bucket.begin(), bucket.begin() + static_cast<std::ptrdiff_t>(scan_list_[mask]));
+		}
+		for (const auto& member_it : member_list)
+		{
+			ticket_list_.erase(member_it.guid_);
+		}
+		match_list.push_back({ team_system_.last_team_id(), member_list });
+		return true;
+	}
+
+	TeamSystem& team_system_;
+	TeamRoleCount composition_{};
+	uint8_t composition_mask_{ 0 };
+	std::vector<uint8_t> bucket_order_list_[kTeamRoleSize];
+	std::deque<Ticket> bucket_list_[kBucketSize];
+	std::array<std::size_t, kBucketSize> scan_list_{};
+	std::array<uint8_t, kTenMemberMaxSize> pick_mask_list_{};
+	std::vector<Party> party_list_;
+	std::unordered_map<Guid, uint64_t> ticket_list_;
+	uint64_t sequence_{ 0 };
+};
@@ -0,0 +1,474 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "teams/bounded_mpsc_queue.h"
+#include "teams/team_command_buffer.h"
+#include "teams/team_system.h"
+
+static constexpr std::size_t kTeamShardBatchSize = 256;
+//shard index lives in the high bits of a sharded team id, the low bits are the shard local team id
+static constexpr uint32_t kTeamShardShift = 48;
+static constexpr Guid kTeamShardLocalMask = (Guid{ 1 } << kTeamShardShift) - 1;
+
+using TeamCommandQueue = BoundedMpscQueue<TeamCommand, kTeamCommandQueueSize>;
+
+inline Guid MakeShardTeamId(const std::size_t shard_index, const Guid team_id)
+{
+	return (static_cast<Guid>(shard_index) << kTeamShardShift) | (team_id & kTeamShardLocalMask);
+}
+
+inline std::size_t ShardIndexOf(const Guid shard_team_id) { return static_cast<std::size_t>(shard_team_id >> kTeamShardShift); }
+inline Guid ShardLocalTeamId(const Guid shard_team_id) { return shard_team_id & kTeamShardLocalMask; }
+
+inline std::size_t HomeShardOf(const Guid guid, const std::size_t shard_size) { return static_cast<std::size_t>(guid % shard_size); }
+
+class TeamShard;
+using TeamShardVector = std::vector<std::unique_ptr<TeamShard>>;
+
+//one worker thread owning a TeamSystem over its own thread local registry.
+//players owned by other threads get a shard local player entity the first time a command names them,
+//dropped again once the player has no team and no application on the shard.
+//every player has a home shard that owns its membership: before JoinTeam or CreateTeam the team's shard
+//reserves each player there and confirms or releases the reservation with the result, ApplyToTeam only asks.
+//a command waiting for its answers lets later commands of the same team run first.
+//the shard advances its timing wheel on the group clock once per loop, so applications expire on their own
+class TeamShard
+{
+public:
+	//in_flight counts every message of the group that is queued or not handled yet, a stopping shard
+	//only exits once it is zero, so no shard waits on an answer from a shard that is gone
+	TeamShard(const std::size_t shard_index, const TeamShardVector& shard_list, std::atomic<int64_t>& in_flight, const TeamClock clock)
+		: shard_index_(shard_index), shard_list_(shard_list), in_flight_(in_flight), clock_(clock)
+	{
+	}
+	~TeamShard() { Stop(); }
+
+	inline std::size_t shard_index() const { return shard_index_; }
+	//shard local player entities, read from any thread
+	inline std::size_t player_size() const { return player_size_.load(std::memory_order_relaxed); }
+
+	bool Post(TeamCommand command)
+	{
+		in_flight_.fetch_add(1, std::memory_order_acq_rel);
+		if (queue_.TryPush(std::move(command)))
+		{
+			return true;
+		}
+		in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+		return false;
+	}
+
+	void Start()
+	{
+		running_.store(true, std::memory_order_release);
+		thread_ = std::thread([this] { Run(); });
+	}
+
+	void RequestStop() { running_.store(false, std::memory_order_release); }
+
+	//commands already queued are executed before the thread exits
+	void Stop()
+	{
+		RequestStop();
+		if (thread_.joinable())
+		{
+			thread_.join();
+		}
+	}
+
+private:
+	//every batch popped from the queue runs as one command buffer flush
+	void Run()
+	{
+		TeamSystem team_system;
+		TeamCommandBuffer command_buffer(team_system);
+		TeamCommandResultVector result_list;
+		TeamCommand command;
+		for (;;)
+		{
+			const bool running = running_.load(std::memory_order_acquire);
+			//an expired application may leave the last reason to keep its player
+			TeamSystem::UpdateTimers(clock_(), [this](const TeamTimer& team_timer) { DropPlayer(team_timer.guid_); });
+			FlushOutbox();
+			int64_t popped = 0;
+			while (command_buffer.size() < kTeamShardBatchSize && queue_.TryPop(command))
+			{
+				Push(command_buffer, command);
+				++popped;
+			}
+			if (!command_buffer.empty())
+			{
+				Flush(command_buffer, result_list);
+			}
+			FlushOutbox();
+			//whatever the popped messages sent is already counted
+			in_flight_.fetch_sub(popped, std::memory_order_acq_rel);
+			if (popped > 0)
+			{
+				continue;
+			}
+			if (!running && outbox_list_.empty() && waiting_list_.empty() && 0 == in_flight_.load(std::memory_order_acquire))
+			{
+				break;
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+	}
+
+	struct Waiting
+	{
+		TeamCommand command_;
+		GuidVector reserved_list_;
+		std::size_t answer_size_{ 0 };
+		uint32_t ret_{ kOK };
+	};
+
+	struct Pending
+	{
+		TeamCommandType type_{ TeamCommandType::kJoinTeam };
+		Guid team_id_{ kInvalidGuid };
+		TeamReplyQueue* reply_queue_{ nullptr };
+		GuidVector reserved_list_;
+	};
+
+	void EnsurePlayer(const Guid guid)
+	{
+		if (entt::null == TeamSystem::GetPlayer(guid))
+		{
+			tlsCommonLogic.GetPlayerList().emplace(guid, tls.registry.create());
+			player_size_.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void DropPlayer(const Guid guid)
+	{
+		const auto player = TeamSystem::GetPlayer(guid);
+		if (entt::null == player || TeamSystem::HasTeam(player) || TeamSystem::apply_team_size_by_player_id(guid) > 0)
+		{
+			return;
+		}
+		Destroy(tls.registry, player);
+		tlsCommonLogic.GetPlayerList().erase(guid);
+		player_size_.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	//the players a command needs from their home shards, none for commands that cannot add a player
+	static GuidVector OwnedPlayers(const TeamCommand& command)
+	{
+		GuidVector guid_list;
+		switch (command.type_)
+		{
+		case TeamCommandType::kCreateTeam:
+			guid_list.emplace_back(command.guid_);
+			for (const auto& member_it : command.member_list_)
+			{
+				if (std::find(guid_list.begin(), guid_list.end(), member_it) == guid_list.end())
+				{
+					guid_list.emplace_back(member_it);
+				}
+			}
+			break;
+		case TeamCommandType::kJoinTeam:
+		case TeamCommandType::kApplyToTeam:
+			guid_list.emplace_back(command.guid_);
+			break;
+		default:
+			break;
+		}
+		return guid_list;
+	}
+
+	void Push(TeamCommandBuffer& command_buffer, const TeamCommand& command)
+	{
+		switch (command.type_)
+		{
+		case TeamCommandType::kReserve:
+		case TeamCommandType::kCheck:
+			OnReserve(command);
+			return;
+		case TeamCommandType::kReserveResult:
+			OnReserveResult(command_buffer, command);
+			return;
+		case TeamCommandType::kConfirm:
+			owner_list_[command.guid_] = command.team_id_;
+			return;
+		case TeamCommandType::kRelease:
+			if (const auto owner_it = owner_list_.find(command.guid_); owner_it != owner_list_.end() && owner_it->second == command.team_id_)
+			{
+				owner_list_.erase(owner_it);
+			}
+			return;
+		default:
+			break;
+		}
+
+		const auto guid_list = OwnedPlayers(command);
+		if (guid_list.empty())
+		{
+			Execute(command_buffer, command, {});
+			return;
+		}
+		const auto token = ++next_token_;
+		auto& waiting = waiting_list_[token];
+		waiting.command_ = command;
+		waiting.answer_size_ = guid_list.size();
+		const auto type = TeamCommandType::kApplyToTeam == command.type_ ? TeamCommandType::kCheck : TeamCommandType::kReserve;
+		for (const auto guid : guid_list)
+		{
+			Send(HomeShardOf(guid, shard_list_.size()), { type, token, kInvalidGuid, guid, shard_index_, {} }, command_buffer);
+		}
+	}
+
+	//home shard side, a player with a membership or a reservation cannot be taken again
+	void OnReserve(const TeamCommand& command)
+	{
+		uint32_t ret = kOK;
+		if (owner_list_.find(command.guid_) != owner_list_.end())
+		{
+			ret = kRetTeamMemberInTeam;
+		}
+		else if (TeamCommandType::kReserve == command.type_)
+		{
+			owner_list_.emplace(command.guid_, kInvalidGuid);
+		}
+		SendOut(static_cast<std::size_t>(command.target_id_), { TeamCommandType::kReserveResult, command.request_id_, kInvalidGuid, command.guid_, ret, {} });
+	}
+
+	void OnReserveResult(TeamCommandBuffer& command_buffer, const TeamCommand& command)
+	{
+		const auto waiting_it = waiting_list_.find(command.request_id_);
+		if (waiting_it == waiting_list_.end())
+		{
+			return;
+		}
+		auto& waiting = waiting_it->second;
+		const auto ret = static_cast<uint32_t>(command.target_id_);
+		if (kOK != ret)
+		{
+			waiting.ret_ = ret;
+		}
+		else if (TeamCommandType::kApplyToTeam != waiting.command_.type_)
+		{
+			waiting.reserved_list_.emplace_back(command.guid_);
+		}
+		if (--waiting.answer_size_ > 0)
+		{
+			return;
+		}
+		const auto done = std::move(waiting);
+		waiting_list_.erase(waiting_it);
+		if (kOK == done.ret_)
+		{
+			Execute(command_buffer, done.command_, done.reserved_list_);
+			return;
+		}
+		for (const auto guid : done.reserved_list_)
+		{
+			Send(HomeShardOf(guid, shard_list_.size()), { TeamCommandType::kRelease, 0, kInvalidGuid, guid, kInvalidGuid, {} }, command_buffer);
+		}
+		Reply(done.command_.reply_queue_, { done.command_.request_id_, done.ret_, done.command_.team_id_ });
+	}
+
+	//the buffer sees shard local team ids, the reply gets back the id the command was sent with
+	void Execute(TeamCommandBuffer& command_buffer, TeamCommand command, const GuidVector& reserved_list)
+	{
+		switch (command.type_)
+		{
+		case TeamCommandType::kCreateTeam:
+			EnsurePlayer(command.guid_);
+			for (const auto& member_it : command.member_list_)
+			{
+				EnsurePlayer(member_it);
+			}
+			break;
+		case TeamCommandType::kJoinTeam:
+		case TeamCommandType::kApplyToTeam:
+			EnsurePlayer(command.guid_);
+			break;
+		default:
+			break;
+		}
+		pending_list_.push_back({ command.type_, command.team_id_, command.reply_queue_, reserved_list });
+		command.team_id_ = ShardLocalTeamId(command.team_id_);
+		//a disband drops every member, the other commands name whoever they drop
+		touched_list_.emplace_back(command.guid_);
+		touched_list_.emplace_back(command.target_id_);
+		touched_list_.insert(touched_list_.end(), command.member_list_.begin(), command.member_list_.end());
+		if (const TeamHandle team(command.team_id_); TeamCommandType::kDisbanded == command.type_ && team)
+		{
+			touched_list_.insert(touched_list_.end(), team->members_.begin(), team->members_.end());
+		}
+		command_buffer.Push(command);
+	}
+
+	void Flush(TeamCommandBuffer& command_buffer, TeamCommandResultVector& result_list)
+	{
+		command_buffer.Flush(result_list);
+		for (std::size_t i = 0; i < result_list.size(); ++i)
+		{
+			auto& result = result_list[i];
+			const auto& pending = pending_list_[i];
+			if (TeamCommandType::kCreateTeam != pending.type_)
+			{
+				result.team_id_ = pending.team_id_;
+			}
+			else if (kOK == result.ret_)
+			{
+				result.team_id_ = MakeShardTeamId(shard_index_, result.team_id_);
+			}
+			for (const auto guid : pending.reserved_list_)
+			{
+				const bool member = kOK == result.ret_;
+				if (member)
+				{
+					hosted_list_[guid] = result.team_id_;
+				}
+				Send(HomeShardOf(guid, shard_list_.size()), { member ? TeamCommandType::kConfirm : TeamCommandType::kRelease, 0, member ? result.team_id_ : kInvalidGuid, guid, kInvalidGuid, {} }, command_buffer);
+			}
+			Reply(pending.reply_queue_, result);
+		}
+		pending_list_.clear();
+
+		for (const auto guid : touched_list_)
+		{
+			if (kInvalidGuid == guid || TeamSystem::HasTeam(guid))
+			{
+				continue;
+			}
+			if (const auto hosted_it = hosted_list_.find(guid); hosted_it != hosted_list_.end())
+			{
+				Send(HomeShardOf(guid, shard_list_.size()), { TeamCommandType::kRelease, 0, hosted_it->second, guid, kInvalidGuid, {} }, command_buffer);
+				hosted_list_.erase(hosted_it);
+			}
+			DropPlayer(guid);
+		}
+		touched_list_.clear();
+	}
+
+	//results are never dropped, the caller has to keep draining its reply queue
+	static void Reply(TeamReplyQueue* reply_queue, const TeamCommandResult& result)
+	{
+		if (nullptr == reply_queue)
+		{
+			return;
+		}
+		while (!reply_queue->TryPush(result))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	//a message to this shard is handled right away, the others go out through the outbox
+	void Send(const std::size_t shard_index, const TeamCommand& command, TeamCommandBuffer& command_buffer)
+	{
+		if (shard_index == shard_index_)
+		{
+			Push(command_buffer, command);
+			return;
+		}
+		SendOut(shard_index, command);
+	}
+
+	void SendOut(const std::size_t shard_index, const TeamCommand& command)
+	{
+		in_flight_.fetch_add(1, std::memory_order_acq_rel);
+		outbox_list_.push_back({ shard_index, command });
+	}
+
+	//never blocks on a full queue so two shards sending to each other cannot deadlock, keeps the send order
+	void FlushOutbox()
+	{
+		std::size_t sent = 0;
+		while (sent < outbox_list_.size())
+		{
+			auto& outgoing = outbox_list_[sent];
+			if (!shard_list_[outgoing.first]->queue_.TryPush(outgoing.second))
+			{
+				break;
+			}
+			++sent;
+		}
+		outbox_list_.erase(outbox_list_.begin(), outbox_list_.begin() + static_cast<std::ptrdiff_t>(sent));
+	}
+
+	std::size_t shard_index_{ 0 };
+	const TeamShardVector& shard_list_;
+	std::atomic<int64_t>& in_flight_;
+	TeamClock clock_{ &TeamSteadyClockMs };
+	std::atomic<std::size_t> player_size_{ 0 };
+	TeamCommandQueue queue_;
+	std::vector<Pending> pending_list_;
+	std::atomic<bool> running_{ false };
+	std::thread thread_;
+
+	//home shard side, players of this home with the sharded team id, kInvalidGuid while only reserved
+	std::unordered_map<Guid, Guid> owner_list_;
+	//team shard side, members of this shard's teams with the sharded team id
+	std::unordered_map<Guid, Guid> hosted_list_;
+	std::unordered_map<uint64_t, Waiting> waiting_list_;
+	uint64_t next_token_{ 0 };
+	GuidVector touched_list_;
+	std::vector<std::pair<std::size_t, TeamCommand>> outbox_list_;
+};
+
+//teams are partitioned across shards, a new team lives on its leader's home shard
+//and every later command is routed by the shard index inside the team id
+class TeamShardGroup
+{
+public:
+	//clock drives the application timeouts of every shard
+	explicit TeamShardGroup(const std::size_t shard_size, const TeamClock clock = &TeamSteadyClockMs)
+	{
+		shard_list_.reserve(shard_size);
+		for (std::size_t i = 0; i < shard_size; ++i)
+		{
+			shard_list_.emplace_back(std::make_unique<TeamShard>(i, shard_list_, in_flight_, clock));
+		}
+		for (const auto& shard : shard_list_)
+		{
+			shard->Start();
+		}
+	}
+
+	~TeamShardGroup() { Stop(); }
+
+	inline std::size_t shard_size() const { return shard_list_.size(); }
+	inline std::size_t HomeShard(const Guid guid) const { return HomeShardOf(guid, shard_list_.size()); }
+	inline std::size_t player_size(const std::size_t shard_index) const { return shard_list_[shard_index]->player_size(); }
+
+	//returns false when the target shard is unknown or its queue is full
+	bool Post(TeamCommand command)
+	{
+		const auto shard_index = TeamCommandType::kCreateTeam == command.type_ ? HomeShard(command.guid_) : ShardIndexOf(command.team_id_);
+		if (shard_index >= shard_list_.size() || command.type_ > TeamCommandType::kDisbanded)
+		{
+			return false;
+		}
+		return shard_list_[shard_index]->Post(std::move(command));
+	}
+
+	//every shard stops taking new work first, then they finish what is still in flight between them
+	void Stop()
+	{
+		for (const auto& shard : shard_list_)
+		{
+			shard->RequestStop();
+		}
+		for (const auto& shard : shard_list_)
+		{
+			shard->Stop();
+		}
+	}
+
+private:
+	std::atomic<int64_t> in_flight_{ 0 };
+	TeamShardVector shard_list_;
+};
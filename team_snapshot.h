@@ -0,0 +1,460 @@
+#pragma once
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "teams/team_system.h"
+
+//saved team or raid id to the id it was restored as
+using TeamIdMap = std::unordered_map<Guid, Guid>;
+
+//versioned binary image of every Team and Raid and the links of their members.
+//teams and raids are restored as new entities, so saved ids only need to be unique inside the image.
+//members and applicants that are not registered yet are linked by LinkPlayer once they are.
+//layout, native byte order, every team comes before the raids that name it:
+//  header: magic u32, version u32, team count u64, raid count u64
+//  team:   team id u64, leader id u64, team type size u32, member count u8, applicant count u8, reserved u16,
+//          member ids u64[member count], applicant ids u64[applicant count]
+//  raid:   raid id u64, leader id u64, team count u8, member count u8, reserved u16, reserved u32,
+//          team ids u64[team count], member ids u64[member count] in join order
+class TeamSnapshot
+{
+public:
+	static constexpr uint32_t kMagic{ 0x4D414554 };
+	static constexpr uint32_t kVersion{ 2 };
+
+	static void Write(std::string& buffer);
+	static bool Read(const char* data, std::size_t size);
+	static bool Read(const char* data, std::size_t size, TeamIdMap& team_id_map);
+	static bool Save(const std::string& path);
+	static bool Load(const std::string& path);
+	static bool Load(const std::string& path, TeamIdMap& team_id_map);
+
+	//call once the player is in tlsCommonLogic.GetPlayerList(), links what the last load left for it
+	static void LinkPlayer(Guid guid);
+	static std::size_t pending_size() { return TeamSystem::pending_link_list().size(); }
+
+private:
+	struct Header
+	{
+		uint32_t magic_{ kMagic };
+		uint32_t version_{ kVersion };
+		uint64_t team_size_{ 0 };
+		uint64_t raid_size_{ 0 };
+	};
+
+	struct TeamRecord
+	{
+		uint64_t team_id_{ 0 };
+		uint64_t leader_id_{ 0 };
+		uint32_t team_type_size_{ 0 };
+		uint8_t member_size_{ 0 };
+		uint8_t applicant_size_{ 0 };
+		uint16_t reserved_{ 0 };
+	};
+	static_assert(sizeof(TeamRecord) == 24, "snapshot record layout changed, bump kVersion");
+
+	struct RaidRecord
+	{
+		uint64_t raid_id_{ 0 };
+		uint64_t leader_id_{ 0 };
+		uint8_t team_size_{ 0 };
+		uint8_t member_size_{ 0 };
+		uint16_t reserved_{ 0 };
+		uint32_t reserved_tail_{ 0 };
+	};
+	static_assert(sizeof(RaidRecord) == 24, "snapshot record layout changed, bump kVersion");
+
+	static bool Validate(const char* data, std::size_t size);
+	static void Restore(const char* data, TeamIdMap& team_id_map);
+	static void AddApplication(entt::entity player, Guid team_id, Guid guid);
+};
+
+void TeamSnapshot::Write(std::string& buffer)
+{
+	auto& storage = tls.registry.storage<Team>();
+	auto& raid_storage = tls.registry.storage<Raid>();
+	Header header;
+	header.team_size_ = storage.size();
+	header.raid_size_ = raid_storage.size();
+	buffer.clear();
+	buffer.reserve(sizeof(Header) + storage.size() * (sizeof(TeamRecord) + sizeof(Guid) * (kTenMemberMaxSize + kMaxApplicantSize)) +
+		raid_storage.size() * (sizeof(RaidRecord) + sizeof(Guid) * (kMaxRaidTeamSize + kMaxRaidMemberSize)));
+	buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (const auto team_entity : storage)
+	{
+		const auto& team = storage.get(team_entity);
+		const auto* const try_applicants = tls.registry.try_get<TeamApplicants>(team_entity);
+		TeamRecord record;
+		record.team_id_ = entt::to_integral(team_entity);
+		record.leader_id_ = team.leader_id();
+		record.team_type_size_ = static_cast<uint32_t>(team.max_member_size());
+		record.member_size_ = static_cast<uint8_t>(team.member_size());
+		record.applicant_size_ = static_cast<uint8_t>(nullptr == try_applicants ? 0 : try_applicants->applicant_list_.size());
+		buffer.append(reinterpret_cast<const char*>(&record), sizeof(record));
+		buffer.append(reinterpret_cast<const char*>(team.members_.begin()), sizeof(Guid) * team.member_size());
+		if (nullptr == try_applicants)
+		{
+			continue;
+		}
+		for (const auto& applicant_it : try_applicants->applicant_list_)
+		{
+			buffer.append(reinterpret_cast<const char*>(&applicant_it), sizeof(applicant_it));
+		}
+	}
+	for (const auto raid_entity : raid_storage)
+	{
+		const auto& raid = raid_storage.get(raid_entity);
+		RaidRecord record;
+		record.raid_id_ = entt::to_integral(raid_entity);
+		record.leader_id_ = raid.leader_id_;
+		record.team_size_ = static_cast<uint8_t>(raid.team_list_.size());
+		record.member_size_ = static_cast<uint8_t>(raid.member_list_.size());
+		buffer.append(reinterpret_cast<const char*>(&record), sizeof(record));
+		buffer.append(reinterpret_cast<const char*>(raid.team_list_.begin()), sizeof(Guid) * raid.team_list_.size());
+		buffer.append(reinterpret_cast<const char*>(raid.member_list_.begin()), sizeof(Guid) * raid.member_list_.size());
+	}
+}
+
+bool TeamSnapshot::Read(const char* data, const std::size_t size)
+{
+	TeamIdMap team_id_map;
+	return Read(data, size, team_id_map);
+}
+
+//bulk load straight into tls.registry, only allowed while there are no teams.
+//the whole image is validated first so a bad file never leaves half the teams loaded
+bool TeamSnapshot::Read(const char* data, const std::size_t size, TeamIdMap& team_id_map)
+{
+	if (TeamSystem::team_size() > 0)
+	{
+		return false;
+	}
+	if (!Validate(data, size))
+	{
+		return false;
+	}
+	team_id_map.clear();
+	TeamSystem::pending_link_list().clear();
+	Restore(data, team_id_map);
+	return true;
+}
+
+void TeamSnapshot::LinkPlayer(const Guid guid)
+{
+	auto& pending_list = TeamSystem::pending_link_list();
+	const auto pending_it = pending_list.find(guid);
+	if (pending_it == pending_list.end())
+	{
+		return;
+	}
+	const auto player = TeamSystem::GetPlayer(guid);
+	if (entt::null == player)
+	{
+		return;
+	}
+	const auto& pending = pending_it->second;
+	//the team may be gone or have dropped the player since the load
+	if (const TeamHandle team(pending.team_id_); team && team->members_.contains(guid) && !TeamSystem::HasTeam(player))
+	{
+		tls.registry.emplace_or_replace<TeamId>(player).set_team_id(pending.team_id_);
+	}
+	for (const auto team_id : pending.apply_team_id_list_)
+	{
+		const TeamHandle team(team_id);
+		if (!team)
+		{
+			continue;
+		}
+		if (const auto* const try_applicants = tls.registry.try_get<TeamApplicants>(team.entity()); nullptr != try_applicants && try_applicants->applicant_list_.contains(guid))
+		{
+			AddApplication(player, team_id, guid);
+		}
+	}
+	if (TeamSystem::raid_member_list(pending.raid_id_).contains(guid) && kInvalidGuid == TeamSystem::GetRaidId(guid))
+	{
+		tls.registry.emplace_or_replace<PlayerRaidLink>(player, pending.raid_id_);
+	}
+	pending_list.erase(pending_it);
+}
+
+bool TeamSnapshot::Validate(const char* data, const std::size_t size)
+{
+	if (size < sizeof(Header))
+	{
+		return false;
+	}
+	Header header;
+	std::memcpy(&header, data, sizeof(header));
+	if (header.magic_ != kMagic || header.version_ != kVersion || header.team_size_ > kMaxTeamSize || header.raid_size_ > header.team_size_)
+	{
+		return false;
+	}
+	//saved team id to its member count, member to its saved team id
+	std::unordered_map<Guid, uint8_t> team_member_size_list;
+	std::unordered_map<Guid, Guid> member_team_list;
+	std::size_t offset = sizeof(Header);
+	for (uint64_t i = 0; i < header.team_size_; ++i)
+	{
+		if (size - offset < sizeof(TeamRecord))
+		{
+			return false;
+		}
+		TeamRecord record;
+		std::memcpy(&record, data + offset, sizeof(record));
+		offset += sizeof(record);
+		if (!TeamSystem::IsTeamType(record.team_type_size_) || record.member_size_ > record.team_type_size_ ||
+			record.applicant_size_ > TeamApplicantQueue::capacity())
+		{
+			return false;
+		}
+		if (!team_member_size_list.emplace(record.team_id_, record.member_size_).second)
+		{
+			return false;
+		}
+		const std::size_t guid_size = sizeof(Guid) * (record.member_size_ + record.applicant_size_);
+		if (size - offset < guid_size)
+		{
+			return false;
+		}
+		//a player is in one team at most
+		for (uint8_t j = 0; j < record.member_size_; ++j)
+		{
+			Guid guid;
+			std::memcpy(&guid, data + offset + sizeof(Guid) * j, sizeof(guid));
+			if (!member_team_list.emplace(guid, record.team_id_).second)
+			{
+				return false;
+			}
+		}
+		offset += guid_size;
+	}
+	UInt64Set raid_id_list;
+	UInt64Set raid_team_list;
+	for (uint64_t i = 0; i < header.raid_size_; ++i)
+	{
+		if (size - offset < sizeof(RaidRecord))
+		{
+			return false;
+		}
+		RaidRecord record;
+		std::memcpy(&record, data + offset, sizeof(record));
+		offset += sizeof(record);
+		//raid ids come from the same entities as team ids
+		if (0 == record.team_size_ || record.team_size_ > kMaxRaidTeamSize || record.member_size_ > kMaxRaidMemberSize ||
+			team_member_size_list.contains(record.raid_id_) || !raid_id_list.emplace(record.raid_id_).second)
+		{
+			return false;
+		}
+		const std::size_t guid_size = sizeof(Guid) * (record.team_size_ + record.member_size_);
+		if (size - offset < guid_size)
+		{
+			return false;
+		}
+		//each group is a saved team of one raid at most, the members are exactly the groups' members and include the leader
+		RaidTeamVector team_list;
+		std::size_t member_size = 0;
+		for (uint8_t j = 0; j < record.team_size_; ++j)
+		{
+			Guid team_id;
+			std::memcpy(&team_id, data + offset + sizeof(Guid) * j, sizeof(team_id));
+			const auto team_it = team_member_size_list.find(team_id);
+			if (team_it == team_member_size_list.end() || !raid_team_list.emplace(team_id).second)
+			{
+				return false;
+			}
+			team_list.emplace_back(team_id);
+			member_size += team_it->second;
+		}
+		if (member_size != record.member_size_)
+		{
+			return false;
+		}
+		UInt64Set raid_member_list;
+		for (uint8_t j = 0; j < record.member_size_; ++j)
+		{
+			Guid guid;
+			std::memcpy(&guid, data + offset + sizeof(Guid) * (record.team_size_ + j), sizeof(guid));
+			const auto member_it = member_team_list.find(guid);
+			if (member_it == member_team_list.end() || !team_list.contains(member_it->second) || !raid_member_list.emplace(guid).second)
+			{
+				return false;
+			}
+		}
+		if (!raid_member_list.contains(record.leader_id_))
+		{
+			return false;
+		}
+		offset += guid_size;
+	}
+	return offset == size;
+}
+
+void TeamSnapshot::Restore(const char* data, TeamIdMap& team_id_map)
+{
+	Header header;
+	std::memcpy(&header, data, sizeof(header));
+	tls.registry.storage<Team>().reserve(header.team_size_);
+	std::size_t offset = sizeof(Header);
+	for (uint64_t i = 0; i < header.team_size_; ++i)
+	{
+		TeamRecord record;
+		std::memcpy(&record, data + offset, sizeof(record));
+		offset += sizeof(record);
+
+		const auto team_entity = tls.registry.create();
+		const auto team_id = entt::to_integral(team_entity);
+		team_id_map.emplace(record.team_id_, team_id);
+		auto& team = tls.registry.emplace<Team>(team_entity);
+		team.team_id_ = team_entity;
+		team.leader_id_ = record.leader_id_;
+		team.team_type_size_ = record.team_type_size_;
+		for (uint8_t j = 0; j < record.member_size_; ++j, offset += sizeof(Guid))
+		{
+			Guid guid;
+			std::memcpy(&guid, data + offset, sizeof(guid));
+			team.members_.emplace_back(guid);
+			if (const auto player = TeamSystem::GetPlayer(guid); entt::null != player)
+			{
+				tls.registry.emplace_or_replace<TeamId>(player).set_team_id(team_id);
+			}
+			else
+			{
+				TeamSystem::pending_link_list()[guid].team_id_ = team_id;
+			}
+		}
+		auto* const try_applicants = record.applicant_size_ > 0 ? &tls.registry.emplace<TeamApplicants>(team_entity) : nullptr;
+		for (uint8_t j = 0; j < record.applicant_size_; ++j, offset += sizeof(Guid))
+		{
+			Guid guid;
+			std::memcpy(&guid, data + offset, sizeof(guid));
+			if (try_applicants->applicant_list_.contains(guid))
+			{
+				continue;
+			}
+			try_applicants->applicant_list_.push_back(guid);
+			if (const auto player = TeamSystem::GetPlayer(guid); entt::null != player)
+			{
+				AddApplication(player, team_id, guid);
+			}
+			else
+			{
+				TeamSystem::pending_link_list()[guid].apply_team_id_list_.emplace_back(team_id);
+			}
+		}
+		TeamSystem::open_team_index().Update(team_id, team.max_member_size(), team.member_size());
+	}
+	tls.registry.storage<Raid>().reserve(header.raid_size_);
+	for (uint64_t i = 0; i < header.raid_size_; ++i)
+	{
+		RaidRecord record;
+		std::memcpy(&record, data + offset, sizeof(record));
+		offset += sizeof(record);
+
+		const auto raid_entity = tls.registry.create();
+		const auto raid_id = entt::to_integral(raid_entity);
+		team_id_map.emplace(record.raid_id_, raid_id);
+		auto& raid = tls.registry.emplace<Raid>(raid_entity);
+		raid.leader_id_ = record.leader_id_;
+		for (uint8_t j = 0; j < record.team_size_; ++j, offset += sizeof(Guid))
+		{
+			Guid saved_team_id;
+			std::memcpy(&saved_team_id, data + offset, sizeof(saved_team_id));
+			const auto team_id = team_id_map.at(saved_team_id);
+			raid.team_list_.emplace_back(team_id);
+			tls.registry.emplace<TeamRaidLink>(entt::to_entity(team_id), raid_id);
+		}
+		for (uint8_t j = 0; j < record.member_size_; ++j, offset += sizeof(Guid))
+		{
+			Guid guid;
+			std::memcpy(&guid, data + offset, sizeof(guid));
+			raid.member_list_.emplace_back(guid);
+			if (const auto player = TeamSystem::GetPlayer(guid); entt::null != player)
+			{
+				tls.registry.emplace_or_replace<PlayerRaidLink>(player, raid_id);
+			}
+			else
+			{
+				TeamSystem::pending_link_list()[guid].raid_id_ = raid_id;
+			}
+		}
+	}
+}
+
+//deadlines are not saved, a restored application gets a full timeout
+void TeamSnapshot::AddApplication(const entt::entity player, const Guid team_id, const Guid guid)
+{
+	auto& timing_wheel = TeamSystem::timing_wheel();
+	const auto timer_id = timing_wheel.Add(timing_wheel.now() + kTeamApplicantTimeoutMs, { TeamTimerType::kApplicant, team_id, guid });
+	tls.registry.get_or_emplace<PlayerTeamApplications>(player).Add(team_id, timer_id);
+}
+
+//written to a temporary file first so a crash during save keeps the previous snapshot
+bool TeamSnapshot::Save(const std::string& path)
+{
+	std::string buffer;
+	Write(buffer);
+	const std::string temp_path = path + ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file.write(buffer.data(), static_cast<std::streamsize>(buffer.size())))
+		{
+			return false;
+		}
+	}
+	std::error_code ec;
+	std::filesystem::rename(temp_path, path, ec);
+	return !ec;
+}
+
+bool TeamSnapshot::Load(const std::string& path)
+{
+	TeamIdMap team_id_map;
+	return Load(path, team_id_map);
+}
+
+bool TeamSnapshot::Load(const std::string& path, TeamIdMap& team_id_map)
+{
+#ifdef _WIN32
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	const std::string buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return Read(buffer.data(), buffer.size(), team_id_map);
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+	struct stat file_stat {};
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+	const auto size = static_cast<std::size_t>(file_stat.st_size);
+	void* const data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (MAP_FAILED == data)
+	{
+		return false;
+	}
+	madvise(data, size, MADV_SEQUENTIAL);
+	const bool ok = Read(static_cast<const char*>(data), size, team_id_map);
+	munmap(data, size);
+	return ok;
+#endif
+}
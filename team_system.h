@@ -4,8 +4,10 @@
 #include "thread_local/storage.h"
 #include "util/snow_flake.h"
 
+#include <algorithm>
 #include <deque>
 #include <list>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -21,11 +23,261 @@
 
 #include "proto/logic/component/team_comp.pb.h"
 
+#include "teams/team_admission.h"
+#include "teams/team_browse_index.h"
+#include "teams/team_delta_journal.h"
+#include "teams/team_guid_simd.h"
+#include "teams/team_metrics.h"
+#include "teams/timing_wheel.h"
+
 static constexpr std::size_t kMaxApplicantSize{ 20 };
+static constexpr std::size_t kMaxTeamInviteSize{ 20 };
+static constexpr std::size_t kMaxPlayerInviteSize{ 10 };
+static constexpr uint64_t kTeamInviteTimeoutMs{ 60000 };
+static constexpr uint64_t kTeamApplicantTimeoutMs{ 300000 };
 
 static constexpr std::size_t kFiveMemberMaxSize{ 5 };
 static constexpr std::size_t kTenMemberMaxSize{ 10 };
+static constexpr std::size_t kMaxRaidTeamSize{ 8 };
+static constexpr std::size_t kMaxRaidMemberSize{ kMaxRaidTeamSize * kTenMemberMaxSize };
+
+
+//fixed capacity array stored inside the component, never allocates.
+//guid arrays are padded for the vector kernels, a lookup compares the whole array and masks off the slots past size
+template <typename T, std::size_t Capacity>
+class InlineVector
+{
+public:
+	using value_type = T;
+	using iterator = T*;
+	using const_iterator = const T*;
+
+	static constexpr bool kGuidMatch = std::is_same_v<T, Guid> && GuidPaddedSize(Capacity) <= kGuidMatchMaxSize;
+	static constexpr std::size_t kStorageSize = kGuidMatch ? GuidPaddedSize(Capacity) : Capacity;
+
+	inline static constexpr std::size_t capacity() { return Capacity; }
+	inline std::size_t size() const { return size_; }
+	inline bool empty() const { return size_ == 0; }
+	inline bool full() const { return size_ >= Capacity; }
+
+	inline iterator begin() { return data_; }
+	inline iterator end() { return data_ + size_; }
+	inline const_iterator begin() const { return data_; }
+	inline const_iterator end() const { return data_ + size_; }
+	inline const T* data() const { return data_; }
+	inline const T& front() const { return data_[0]; }
+	inline T& operator[](const std::size_t index) { return data_[index]; }
+	inline const T& operator[](const std::size_t index) const { return data_[index]; }
+
+	inline const_iterator find(const T& value) const
+	{
+		if constexpr (kGuidMatch)
+		{
+			const auto mask = GuidMatch(data_, kStorageSize, value) & GuidSizeMask(size_);
+			return 0 == mask ? end() : data_ + GuidMatchIndex(mask);
+		}
+		else
+		{
+			return std::find(begin(), end(), value);
+		}
+	}
+
+	inline bool contains(const T& value) const { return find(value) != end(); }
+
+	void emplace_back(const T& value) { data_[size_++] = value; }
+
+	//keeps order, the first member is the next leader
+	iterator erase(const_iterator it)
+	{
+		auto* const pos = data_ + (it - data_);
+		std::copy(pos + 1, end(), pos);
+		--size_;
+		return pos;
+	}
+
+	void clear() { size_ = 0; }
+
+private:
+	std::size_t size_{ 0 };
+	T data_[kStorageSize]{};
+};
+
+using TeamMemberVector = InlineVector<Guid, kTenMemberMaxSize>;
+
+//fixed capacity fifo of unique guids, stored inside the component.
+//slots are linked in arrival order and a small open addressing index maps guid to slot,
+//so push, pop front, contains and erase from the middle are all O(1)
+template <std::size_t Capacity>
+class InlineGuidQueue
+{
+public:
+	using slot_type = uint8_t;
+	static constexpr slot_type kNullSlot = UINT8_MAX;
+	static_assert(Capacity > 0 && Capacity < kNullSlot, "slot index must fit in uint8_t");
+
+	class const_iterator
+	{
+	public:
+		const_iterator(const InlineGuidQueue* queue, const slot_type slot) : queue_(queue), slot_(slot) {}
+		inline Guid operator*() const { return queue_->slots_[slot_]; }
+		inline const_iterator& operator++() { slot_ = queue_->next_[slot_]; return *this; }
+		inline bool operator==(const const_iterator& rhs) const { return slot_ == rhs.slot_; }
+		inline bool operator!=(const const_iterator& rhs) const { return slot_ != rhs.slot_; }
+	private:
+		const InlineGuidQueue* queue_{ nullptr };
+		slot_type slot_{ kNullSlot };
+	};
+
+	InlineGuidQueue() { clear(); }
+
+	inline static constexpr std::size_t capacity() { return Capacity; }
+	inline std::size_t size() const { return size_; }
+	inline bool empty() const { return size_ == 0; }
+	inline bool full() const { return size_ >= Capacity; }
+	inline Guid front() const { return empty() ? kInvalidGuid : slots_[head_]; }
+
+	inline const_iterator begin() const { return const_iterator(this, head_); }
+	inline const_iterator end() const { return const_iterator(this, kNullSlot); }
+
+	inline bool contains(const Guid guid) const { return FindBucket(guid) != kBucketSize; }
+
+	//caller checks full() and contains() first
+	void push_back(const Guid guid)
+	{
+		const slot_type slot = free_;
+		free_ = next_[slot];
+		slots_[slot] = guid;
+		prev_[slot] = tail_;
+		next_[slot] = kNullSlot;
+		if (kNullSlot == tail_)
+		{
+			head_ = slot;
+		}
+		else
+		{
+			next_[tail_] = slot;
+		}
+		tail_ = slot;
+		++size_;
+		auto bucket = Hash(guid);
+		while (kNullSlot != buckets_[bucket])
+		{
+			bucket = (bucket + 1) & kBucketMask;
+		}
+		buckets_[bucket] = slot;
+	}
+
+	Guid pop_front()
+	{
+		const Guid guid = front();
+		erase(guid);
+		return guid;
+	}
+
+	bool erase(const Guid guid)
+	{
+		const auto bucket = FindBucket(guid);
+		if (bucket == kBucketSize)
+		{
+			return false;
+		}
+		const slot_type slot = buckets_[bucket];
+		EraseBucket(bucket);
+		if (kNullSlot == prev_[slot])
+		{
+			head_ = next_[slot];
+		}
+		else
+		{
+			next_[prev_[slot]] = next_[slot];
+		}
+		if (kNullSlot == next_[slot])
+		{
+			tail_ = prev_[slot];
+		}
+		else
+		{
+			prev_[next_[slot]] = prev_[slot];
+		}
+		next_[slot] = free_;
+		free_ = slot;
+		--size_;
+		return true;
+	}
+
+	void clear()
+	{
+		for (std::size_t i = 0; i < Capacity; ++i)
+		{
+			next_[i] = static_cast<slot_type>(i + 1);
+		}
+		next_[Capacity - 1] = kNullSlot;
+		std::fill(std::begin(buckets_), std::end(buckets_), kNullSlot);
+		head_ = kNullSlot;
+		tail_ = kNullSlot;
+		free_ = 0;
+		size_ = 0;
+	}
+
+private:
+	static constexpr std::size_t BucketSize()
+	{
+		std::size_t size = 1;
+		while (size < Capacity * 2)
+		{
+			size <<= 1;
+		}
+		return size;
+	}
+	static constexpr std::size_t kBucketSize = BucketSize();
+	static constexpr std::size_t kBucketMask = kBucketSize - 1;
+
+	inline static std::size_t Hash(const Guid guid)
+	{
+		return static_cast<std::size_t>((guid * 0x9E3779B97F4A7C15ull) >> 32) & kBucketMask;
+	}
+
+	std::size_t FindBucket(const Guid guid) const
+	{
+		for (auto bucket = Hash(guid); kNullSlot != buckets_[bucket]; bucket = (bucket + 1) & kBucketMask)
+		{
+			if (slots_[buckets_[bucket]] == guid)
+			{
+				return bucket;
+			}
+		}
+		return kBucketSize;
+	}
+
+	//backward shift deletion keeps probe chains intact without tombstones
+	void EraseBucket(std::size_t bucket)
+	{
+		for (auto next = (bucket + 1) & kBucketMask; kNullSlot != buckets_[next]; next = (next + 1) & kBucketMask)
+		{
+			const auto home = Hash(slots_[buckets_[next]]);
+			if (((next - home) & kBucketMask) >= ((next - bucket) & kBucketMask))
+			{
+				buckets_[bucket] = buckets_[next];
+				bucket = next;
+			}
+		}
+		buckets_[bucket] = kNullSlot;
+	}
+
+	Guid slots_[Capacity]{};
+	slot_type prev_[Capacity]{};
+	slot_type next_[Capacity]{};
+	slot_type buckets_[kBucketSize]{};
+	slot_type head_{ kNullSlot };
+	slot_type tail_{ kNullSlot };
+	slot_type free_{ 0 };
+	slot_type size_{ 0 };
+};
+
+using TeamApplicantQueue = InlineGuidQueue<kMaxApplicantSize>;
 
+//a team type is the member capacity of a team. members live inline in Team, raid sized groups are built from several teams
+static_assert(kFiveMemberMaxSize <= TeamMemberVector::capacity() && kTenMemberMaxSize <= TeamMemberVector::capacity());
 
 //function order get, set is, test action
 struct CreateTeamP
@@ -35,6 +287,8 @@ struct CreateTeamP
 	std::size_t team_type_size_{ kFiveMemberMaxSize };
 };
 
+//hot part of a team, read by every check and by sweeps over the whole Team storage.
+//applicants live in TeamApplicants so a sweep does not pull them through the cache
 class Team
 {
 public:
@@ -43,23 +297,201 @@ public:
 	inline std::size_t max_member_size() const { return team_type_size_; }
 	inline std::size_t member_size() const { return members_.size(); }
 	inline bool empty() const { return members_.empty(); }
-	inline std::size_t applicant_size() const { return applicants_.size(); }
 
-	inline bool IsApplicant(const Guid guid) const { return std::find(applicants_.begin(), applicants_.end(), guid) != applicants_.end(); }
 	inline bool IsFull() const { return members_.size() >= max_member_size(); }
 	inline bool IsLeader(const Guid guid) const { return leader_id_ == guid; }
-	inline bool HasMember(const Guid guid) const { return std::find(members_.begin(), members_.end(), guid) != members_.end(); }
+	inline bool HasMember(const Guid guid) const { return members_.contains(guid); }
 
 	void OnAppointLeader(const Guid new_leader_guid) { leader_id_ = new_leader_guid; }
 
 
 	Guid leader_id_{ kInvalidGuid };
 	entt::entity team_id_{ entt::null };
-	GuidVector members_;
-	GuidVector applicants_;
+	TeamMemberVector members_;
 	std::size_t team_type_size_{ kFiveMemberMaxSize };
 };
 
+//cold part of a team, only apply flows touch it. lives on the team entity while the team has applicants
+struct TeamApplicants
+{
+	TeamApplicantQueue applicant_list_;
+};
+
+enum class TeamTimerType : uint8_t
+{
+	kInvite,
+	kApplicant,
+};
+
+//what a timer on the team timing wheel stands for, handed back to the caller of UpdateTimers when it fires
+struct TeamTimer
+{
+	TeamTimerType type_{ TeamTimerType::kInvite };
+	Guid team_id_{ kInvalidGuid };
+	Guid guid_{ kInvalidGuid };
+};
+
+using TeamTimingWheel = TimingWheel<TeamTimer>;
+
+struct PlayerTeamApplication
+{
+	Guid team_id_{ kInvalidGuid };
+	TeamTimingWheel::TimerId timer_id_{ TeamTimingWheel::kInvalidTimerId };
+};
+
+//teams a player has applied to with the deadline timer of each application,
+//lives on the player entity while the player has pending applications
+class PlayerTeamApplications
+{
+public:
+	inline std::size_t size() const { return application_list_.size(); }
+	inline bool empty() const { return application_list_.empty(); }
+	inline bool HasApplied(const Guid team_id) const
+	{
+		return std::any_of(application_list_.begin(), application_list_.end(), [team_id](const PlayerTeamApplication& application) { return application.team_id_ == team_id; });
+	}
+
+	void Add(const Guid team_id, const TeamTimingWheel::TimerId timer_id) { application_list_.push_back({ team_id, timer_id }); }
+
+	//returns the timer of the application, invalid when the player had not applied
+	TeamTimingWheel::TimerId Del(const Guid team_id)
+	{
+		const auto it = std::find_if(application_list_.begin(), application_list_.end(), [team_id](const PlayerTeamApplication& application) { return application.team_id_ == team_id; });
+		if (it == application_list_.end())
+		{
+			return TeamTimingWheel::kInvalidTimerId;
+		}
+		const auto timer_id = it->timer_id_;
+		*it = application_list_.back();
+		application_list_.pop_back();
+		return timer_id;
+	}
+
+	std::vector<PlayerTeamApplication> application_list_;
+};
+
+struct TeamInvite
+{
+	Guid guid_{ kInvalidGuid };
+	Guid inviter_id_{ kInvalidGuid };
+	TeamTimingWheel::TimerId timer_id_{ TeamTimingWheel::kInvalidTimerId };
+};
+
+//pending invites a team has sent, oldest first. lives on the team entity while the team has pending invites
+class TeamInvites
+{
+public:
+	inline std::size_t size() const { return invite_list_.size(); }
+	inline bool empty() const { return invite_list_.empty(); }
+	inline bool full() const { return invite_list_.full(); }
+	inline const TeamInvite& front() const { return invite_list_.front(); }
+
+	TeamInvite* Find(const Guid guid)
+	{
+		const auto it = std::find_if(invite_list_.begin(), invite_list_.end(), [guid](const TeamInvite& invite) { return invite.guid_ == guid; });
+		return it == invite_list_.end() ? nullptr : it;
+	}
+
+	InlineVector<TeamInvite, kMaxTeamInviteSize> invite_list_;
+};
+
+//teams that invited the player, oldest first. lives on the player entity while the player has pending invites
+class PlayerTeamInvites
+{
+public:
+	inline std::size_t size() const { return team_list_.size(); }
+	inline bool empty() const { return team_list_.empty(); }
+	inline bool full() const { return team_list_.full(); }
+	inline bool IsInvited(const Guid team_id) const { return team_list_.contains(team_id); }
+
+	void Del(const Guid team_id)
+	{
+		const auto it = team_list_.find(team_id);
+		if (it != team_list_.end())
+		{
+			team_list_.erase(it);
+		}
+	}
+
+	InlineVector<Guid, kMaxPlayerInviteSize> team_list_;
+};
+
+using RaidTeamVector = InlineVector<Guid, kMaxRaidTeamSize>;
+using RaidMemberVector = InlineVector<Guid, kMaxRaidMemberSize>;
+
+//several teams under one leader, lives on its own entity and the raid id is that entity.
+//the groups stay ordinary Team entities, the raid keeps their ids and every member in join order for broadcasts
+struct Raid
+{
+	inline bool IsLeader(const Guid guid) const { return leader_id_ == guid; }
+
+	Guid leader_id_{ kInvalidGuid };
+	RaidTeamVector team_list_;
+	RaidMemberVector member_list_;
+};
+
+//on a team entity that is a raid group
+struct TeamRaidLink
+{
+	Guid raid_id_{ kInvalidGuid };
+};
+
+//on the player entity of every raid member, raid wide lookups stop here instead of walking the groups
+struct PlayerRaidLink
+{
+	Guid raid_id_{ kInvalidGuid };
+};
+
+//what a snapshot load could not link to a player that was not registered yet, TeamSnapshot::LinkPlayer links it
+struct TeamPendingLink
+{
+	Guid team_id_{ kInvalidGuid };
+	Guid raid_id_{ kInvalidGuid };
+	GuidVector apply_team_id_list_;
+};
+
+using TeamPendingLinkMap = std::unordered_map<Guid, TeamPendingLink>;
+
+//player entity resolved once from tlsCommonLogic.GetPlayerList()
+struct TeamPlayer
+{
+	Guid guid_{ kInvalidGuid };
+	entt::entity entity_{ entt::null };
+};
+
+using TeamPlayerVector = InlineVector<TeamPlayer, kTenMemberMaxSize>;
+
+using OpenTeamIndex = TeamBrowseIndex<kTenMemberMaxSize>;
+
+
+//team resolved and validated once, compound operations pass it down instead of the Guid.
+//the pointer is only valid until the next Team is created or destroyed
+class TeamHandle
+{
+public:
+	explicit TeamHandle(const Guid team_id) : team_id_(team_id), entity_(entt::to_entity(team_id))
+	{
+		if (tls.registry.valid(entity_))
+		{
+			team_ = tls.registry.try_get<Team>(entity_);
+		}
+	}
+	explicit TeamHandle(const entt::entity team_entity)
+		: team_id_(entt::to_integral(team_entity)), entity_(team_entity), team_(tls.registry.try_get<Team>(team_entity))
+	{
+	}
+
+	inline explicit operator bool() const { return nullptr != team_; }
+	inline Guid team_id() const { return team_id_; }
+	inline entt::entity entity() const { return entity_; }
+	inline Team* operator->() const { return team_; }
+	inline Team& operator*() const { return *team_; }
+
+private:
+	Guid team_id_{ kInvalidGuid };
+	entt::entity entity_{ entt::null };
+	Team* team_{ nullptr };
+};
 
 static constexpr std::size_t kMaxTeamSize = 10000;
 
@@ -68,12 +500,17 @@ class TeamSystem final
 public:
     ~TeamSystem();
 
+    static void Reset();
+
     static std::size_t team_size();
     static std::size_t member_size(Guid team_id);
     static std::size_t applicant_size_by_player_id(Guid guid);
     static std::size_t applicant_size_by_team_id(Guid team_id);
+    static std::size_t apply_team_size_by_player_id(Guid guid);
     static std::size_t players_size();
+    static entt::entity GetPlayer(Guid guid);
     static Guid GetTeamId(Guid guid);
+    static Guid GetTeamId(entt::entity player);
     [[nodiscard]] Guid last_team_id() const;
     static Guid get_leader_id_by_team_id(Guid team_id);
     static Guid get_leader_id_by_player_id(Guid guid);
@@ -83,36 +520,158 @@ public:
     static bool IsTeamFull(Guid team_id);
     static bool HasMember(Guid team_id, Guid guid);
     static bool HasTeam(Guid guid);
+    static bool HasTeam(entt::entity player);
     static bool IsApplicant(Guid team_id, Guid guid);
+    static bool IsInvited(Guid team_id, Guid guid);
+    static std::size_t FindMembers(const GuidVector& guid_list, const GuidVector& team_id_list, GuidVector& team_id_by_guid);
+    static std::size_t invite_size_by_team_id(Guid team_id);
+    static std::size_t invite_size_by_player_id(Guid guid);
+    static std::size_t raid_size();
+    static std::size_t raid_member_size(Guid raid_id);
+    static Guid GetRaidId(Guid guid);
+    static Guid get_leader_id_by_raid_id(Guid raid_id);
+    static bool HasRaidMember(Guid raid_id, Guid guid);
+    static const RaidTeamVector& raid_team_list(Guid raid_id);
+    static const RaidMemberVector& raid_member_list(Guid raid_id);
+    static bool IsTeamType(std::size_t team_type_size);
 
     uint32_t CreateTeam(const CreateTeamP& param);
+    uint32_t CreateTeams(const std::vector<CreateTeamP>& param_list, GuidVector& team_id_list);
     static uint32_t JoinTeam(Guid team_id, Guid guid);
+    static uint32_t JoinTeam(const TeamHandle& team, Guid guid);
     static uint32_t JoinTeam(const UInt64Set& member_list, Guid team_id);
     static uint32_t LeaveTeam(Guid guid);
+    static uint32_t LeaveTeam(const TeamHandle& team, Guid guid);
     static uint32_t KickMember(Guid team_id, Guid current_leader_id, Guid be_kick_id);
+    static uint32_t KickMember(const TeamHandle& team, Guid current_leader_id, Guid be_kick_id);
     static uint32_t Disbanded(Guid team_id, Guid current_leader_id);
+    static uint32_t Disbanded(const TeamHandle& team, Guid current_leader_id);
     static uint32_t DisbandedTeamNoLeader(Guid team_id);
+    static uint32_t DisbandTeams(const GuidVector& team_id_list);
     static uint32_t AppointLeader(Guid team_id, Guid current_leader_id, Guid new_leader_id);
+    static uint32_t AppointLeader(const TeamHandle& team, Guid current_leader_id, Guid new_leader_id);
+    static uint32_t MergeTeams(Guid from_team_id, Guid team_id, Guid leader_id);
+    static uint32_t TransferMembers(Guid from_team_id, Guid team_id, const UInt64Set& member_list);
     static uint32_t ApplyToTeam(Guid team_id, Guid guid);
+    static uint32_t ApplyToTeam(const TeamHandle& team, Guid guid);
     static uint32_t DelApplicant(Guid team_id, Guid apply_guid);
+    static uint32_t DelApplicant(const TeamHandle& team, Guid apply_guid);
     static void ClearApplyList(Guid team_id);
+    static uint32_t WithdrawApplications(Guid guid);
+    static uint32_t InviteToTeam(Guid team_id, Guid inviter_id, Guid guid);
+    static uint32_t AcceptInvite(Guid team_id, Guid guid);
+    static uint32_t DeclineInvite(Guid team_id, Guid guid);
+    static uint32_t CreateRaid(Guid team_id, Guid current_leader_id);
+    static uint32_t AddRaidTeam(Guid raid_id, Guid current_leader_id, Guid team_id);
+    static uint32_t JoinRaid(Guid raid_id, Guid guid);
+    static uint32_t MoveRaidMember(Guid raid_id, Guid current_leader_id, Guid guid, Guid team_id);
+    static uint32_t AppointRaidLeader(Guid raid_id, Guid current_leader_id, Guid new_leader_id);
+    static uint32_t DisbandRaid(Guid raid_id, Guid current_leader_id);
 
     static uint32_t AddMember(Guid team_id, Guid guid);
+    static uint32_t AddMember(Guid team_id, Guid guid, entt::entity player);
+    static uint32_t AddMember(const TeamHandle& team, Guid guid, entt::entity player);
     static uint32_t DelMember(Guid team_id, Guid guid);
+    static uint32_t DelMember(Guid team_id, Guid guid, entt::entity player);
+    static uint32_t DelMember(const TeamHandle& team, Guid guid, entt::entity player);
+
+    static TeamDeltaJournal& journal();
+    static OpenTeamIndex& open_team_index();
+    static std::size_t FindOpenTeams(std::size_t min_free_slots, std::size_t count, GuidVector& team_id_list, TeamBrowseCursor& cursor);
+    static TeamTimingWheel& timing_wheel();
+    static TeamAdmission& admission();
+    static TeamPendingLinkMap& pending_link_list();
+    template <typename Func>
+    static void UpdateTimers(uint64_t now_ms, Func&& on_expire);
 
 private:
-    [[nodiscard]] static uint32_t CheckMemberInTeam(const UInt64Set& member_list);
-    static void EraseTeam(entt::entity team_id);
+    [[nodiscard]] static uint32_t CheckMemberInTeam(const UInt64Set& member_list, TeamPlayerVector& player_list);
+    [[nodiscard]] static uint32_t CheckCreateTeam(const CreateTeamP& param, TeamPlayerVector& player_list);
+    static Guid CommitCreateTeam(const CreateTeamP& param, const TeamPlayerVector& player_list);
+    static void DisbandTeam(const TeamHandle& team);
+    static void EraseTeam(const TeamHandle& team);
+    static void DelPlayerApplication(Guid guid, Guid team_id);
+    static bool EraseApplicant(const TeamHandle& team, Guid guid);
+    static void WithdrawApplications(entt::entity player, Guid guid);
+    static void UpdateOpenTeam(const TeamHandle& team);
+    static bool DelInvite(Guid team_id, Guid guid, bool cancel_timer);
+    static void DropPlayerInvites(entt::entity player, Guid guid);
+    static void DropTeamInvites(const TeamHandle& team);
+    static bool Admit(TeamOp op, entt::entity team_entity, entt::entity player);
+    static Raid* TryGetRaid(Guid raid_id);
+    static void LinkRaidTeam(Guid raid_id, Raid& raid, const TeamHandle& team);
+    static void UnlinkRaidTeam(Guid raid_id, Guid team_id);
+    static void AddRaidMember(Guid raid_id, Guid guid, entt::entity player);
+    static void DelRaidMember(Guid raid_id, Guid guid, entt::entity player);
+    static Guid GetTeamRaidId(const TeamHandle& team);
+    static void RelinkMembers(const TeamHandle& from_team, const TeamHandle& team, const TeamMemberVector& member_list);
+    static void OnMembersMovedOut(const TeamHandle& team);
+    static void MergeApplicants(const TeamHandle& from_team, const TeamHandle& team);
+    uint32_t DoCreateTeam(const CreateTeamP& param);
+    uint32_t DoCreateTeams(const std::vector<CreateTeamP>& param_list, GuidVector& team_id_list);
+    static uint32_t DoJoinTeam(const TeamHandle& team, Guid guid, entt::entity player);
+    static uint32_t DoJoinTeam(const UInt64Set& member_list, Guid team_id);
+    static uint32_t DoLeaveTeam(const TeamHandle& team, Guid guid, entt::entity player);
+    static uint32_t DoKickMember(const TeamHandle& team, Guid current_leader_id, Guid be_kick_id);
+    static uint32_t DoDisbanded(const TeamHandle& team, Guid current_leader_id);
+    static uint32_t DoDisbandedTeamNoLeader(Guid team_id);
+    static uint32_t DoDisbandTeams(const GuidVector& team_id_list);
+    static uint32_t DoAppointLeader(const TeamHandle& team, Guid current_leader_id, Guid new_leader_id);
+    static uint32_t DoMergeTeams(const TeamHandle& from_team, const TeamHandle& team, Guid leader_id);
+    static uint32_t DoTransferMembers(const TeamHandle& from_team, const TeamHandle& team, const UInt64Set& member_list);
+    static uint32_t DoApplyToTeam(const TeamHandle& team, Guid guid, entt::entity player);
+    static uint32_t DoDelApplicant(const TeamHandle& team, Guid guid);
+    static uint32_t DoWithdrawApplications(Guid guid);
+    static uint32_t DoInviteToTeam(Guid team_id, Guid inviter_id, Guid guid);
+    static uint32_t DoAcceptInvite(Guid team_id, Guid guid);
+    static uint32_t DoCreateRaid(const TeamHandle& team, Guid current_leader_id);
+    static uint32_t DoAddRaidTeam(Guid raid_id, Guid current_leader_id, const TeamHandle& team);
+    static uint32_t DoJoinRaid(Guid raid_id, Guid guid);
+    static uint32_t DoMoveRaidMember(Guid raid_id, Guid current_leader_id, Guid guid, const TeamHandle& team);
+    static uint32_t DoAppointRaidLeader(Guid raid_id, Guid current_leader_id, Guid new_leader_id);
+    static uint32_t DoDisbandRaid(Guid raid_id, Guid current_leader_id);
 
     Guid last_team_id_{0}; //for test
 };
 
+//resets on entry and on exit, for instance runs and tests that reuse the thread's team state
+class TeamSystemResetScope
+{
+public:
+	TeamSystemResetScope() { TeamSystem::Reset(); }
+	~TeamSystemResetScope() { TeamSystem::Reset(); }
+
+	TeamSystemResetScope(const TeamSystemResetScope&) = delete;
+	TeamSystemResetScope& operator=(const TeamSystemResetScope&) = delete;
+};
+
 TeamSystem::~TeamSystem()
 {
-	for (const auto& [fst, snd] : tlsCommonLogic.GetPlayerList())
+	Reset();
+}
+
+//drops every team, raid, membership, application, invite, rate limit bucket and pending snapshot link of this thread in O(teams),
+//the per player storages are cleared in bulk instead of per player. the admission limits are kept
+void TeamSystem::Reset()
+{
+	auto& team_storage = tls.registry.storage<Team>();
+	const std::vector<entt::entity> team_entity_list(team_storage.begin(), team_storage.end());
+	for (const auto team_entity : team_entity_list)
 	{
-		LeaveTeam(fst);
+		Destroy(tls.registry, team_entity);
 	}
+	auto& raid_storage = tls.registry.storage<Raid>();
+	const std::vector<entt::entity> raid_entity_list(raid_storage.begin(), raid_storage.end());
+	for (const auto raid_entity : raid_entity_list)
+	{
+		Destroy(tls.registry, raid_entity);
+	}
+	tls.registry.clear<TeamId, PlayerTeamApplications, PlayerTeamInvites, PlayerTeamRequestBucket, PlayerRaidLink>();
+	open_team_index().Clear();
+	journal().Clear();
+	timing_wheel().Clear();
+	admission().ClearCounters();
+	pending_link_list().clear();
 }
 
 std::size_t TeamSystem::team_size()
@@ -132,17 +691,12 @@ bool TeamSystem::IsTeamListMax()
 
 std::size_t TeamSystem::member_size(const Guid team_id)
 {
-	const auto team = entt::to_entity(team_id);
-	if (!tls.registry.valid(team))
-	{
-		return 0;
-	}
-	const auto* const try_team = tls.registry.try_get<Team>(team);
-	if (nullptr == try_team)
+	const TeamHandle team(team_id);
+	if (!team)
 	{
 		return 0;
 	}
-	return try_team->member_size();
+	return team->member_size();
 }
 
 std::size_t TeamSystem::applicant_size_by_player_id(const Guid guid)
@@ -153,17 +707,28 @@ std::size_t TeamSystem::applicant_size_by_player_id(const Guid guid)
 
 std::size_t TeamSystem::applicant_size_by_team_id(const Guid team_id)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
+	const TeamHandle team(team_id);
+	if (!team)
+	{
+		return 0;
+	}
+	const auto* const try_applicants = tls.registry.try_get<TeamApplicants>(team.entity());
+	return nullptr == try_applicants ? 0 : try_applicants->applicant_list_.size();
+}
+
+std::size_t TeamSystem::apply_team_size_by_player_id(const Guid guid)
+{
+	const auto player = GetPlayer(guid);
+	if (entt::null == player)
 	{
 		return 0;
 	}
-	const auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	const auto* const try_applications = tls.registry.try_get<PlayerTeamApplications>(player);
+	if (nullptr == try_applications)
 	{
 		return 0;
 	}
-	return try_team->applicant_size();
+	return try_applications->size();
 }
 
 std::size_t TeamSystem::players_size()
@@ -171,14 +736,28 @@ std::size_t TeamSystem::players_size()
 	return tls.registry.storage<TeamId>().size();
 }
 
-Guid TeamSystem::GetTeamId(const Guid guid)
+entt::entity TeamSystem::GetPlayer(const Guid guid)
 {
 	const auto pit = tlsCommonLogic.GetPlayerList().find(guid);
 	if (pit == tlsCommonLogic.GetPlayerList().end())
+	{
+		return entt::null;
+	}
+	return pit->second;
+}
+
+Guid TeamSystem::GetTeamId(const Guid guid)
+{
+	return GetTeamId(GetPlayer(guid));
+}
+
+Guid TeamSystem::GetTeamId(const entt::entity player)
+{
+	if (entt::null == player)
 	{
 		return entt::null_t();
 	}
-	const auto* try_team_id = tls.registry.try_get<TeamId>(pit->second);
+	const auto* try_team_id = tls.registry.try_get<TeamId>(player);
 	if (nullptr == try_team_id)
 	{
 		return entt::null_t();
@@ -188,17 +767,12 @@ Guid TeamSystem::GetTeamId(const Guid guid)
 
 Guid TeamSystem::get_leader_id_by_team_id(const Guid team_id)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
-	{
-		return kInvalidGuid;
-	}
-	const auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	const TeamHandle team(team_id);
+	if (!team)
 	{
 		return kInvalidGuid;
 	}
-	return try_team->leader_id();
+	return team->leader_id();
 }
 
 Guid TeamSystem::get_leader_id_by_player_id(const Guid guid)
@@ -208,218 +782,382 @@ Guid TeamSystem::get_leader_id_by_player_id(const Guid guid)
 
 Guid TeamSystem::first_applicant(const Guid team_id)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
+	const TeamHandle team(team_id);
+	if (!team)
 	{
 		return kInvalidGuid;
 	}
-	const auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
-	{
-		return kInvalidGuid;
-	}
-	if (try_team->applicants_.empty())
-	{
-		return kInvalidGuid;
-	}
-	return *try_team->applicants_.begin();
+	const auto* const try_applicants = tls.registry.try_get<TeamApplicants>(team.entity());
+	return nullptr == try_applicants ? kInvalidGuid : try_applicants->applicant_list_.front();
 }
 
 bool TeamSystem::IsTeamFull(const Guid team_id)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
-	{
-		return false;
-	}
-	const auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	const TeamHandle team(team_id);
+	if (!team)
 	{
 		return false;
 	}
-	return try_team->IsFull();
+	return team->IsFull();
 }
 
 bool TeamSystem::HasMember(const Guid team_id, const Guid guid)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
-	{
-		return false;
-	}
-	const auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	const TeamHandle team(team_id);
+	if (!team)
 	{
 		return false;
 	}
-	return try_team->HasMember(guid);
+	return team->HasMember(guid);
 }
 
 bool TeamSystem::HasTeam(const Guid guid)
 {
-	const auto pit = tlsCommonLogic.GetPlayerList().find(guid);
-	if (pit == tlsCommonLogic.GetPlayerList().end())
+	return HasTeam(GetPlayer(guid));
+}
+
+bool TeamSystem::HasTeam(const entt::entity player)
+{
+	if (entt::null == player)
 	{
 		return false;
 	}
-	return tls.registry.any_of<TeamId>(pit->second);
+	return tls.registry.any_of<TeamId>(player);
 }
 
 bool TeamSystem::IsApplicant(const Guid team_id, const Guid guid)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
+	const TeamHandle team(team_id);
+	if (!team)
 	{
 		return false;
 	}
-	const auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	const auto* const try_applicants = tls.registry.try_get<TeamApplicants>(team.entity());
+	return nullptr != try_applicants && try_applicants->applicant_list_.contains(guid);
+}
+
+bool TeamSystem::IsInvited(const Guid team_id, const Guid guid)
+{
+	const TeamHandle team(team_id);
+	if (!team)
 	{
 		return false;
 	}
-	return try_team->IsApplicant(guid);
+	auto* const try_invites = tls.registry.try_get<TeamInvites>(team.entity());
+	return nullptr != try_invites && nullptr != try_invites->Find(guid);
 }
 
-uint32_t TeamSystem::CreateTeam(const CreateTeamP& param)
+//every guid is tested against one team at a time with the batch kernel, the team's members stay in registers.
+//team_id_by_guid[i] is the team of team_id_list holding guid_list[i], kInvalidGuid when none does
+std::size_t TeamSystem::FindMembers(const GuidVector& guid_list, const GuidVector& team_id_list, GuidVector& team_id_by_guid)
 {
-	if (IsTeamListMax())
+	team_id_by_guid.assign(guid_list.size(), kInvalidGuid);
+	std::vector<uint8_t> hit_list(guid_list.size());
+	std::size_t found = 0;
+	for (const auto& team_id : team_id_list)
 	{
-		return kRetTeamListMaxSize;
+		const TeamHandle team(team_id);
+		if (!team)
+		{
+			continue;
+		}
+		GuidBatchMatch(team->members_.data(), TeamMemberVector::kStorageSize, team->member_size(), guid_list.data(), guid_list.size(), hit_list.data());
+		for (std::size_t i = 0; i < hit_list.size(); ++i)
+		{
+			if (hit_list[i] && kInvalidGuid == team_id_by_guid[i])
+			{
+				team_id_by_guid[i] = team_id;
+				++found;
+			}
+		}
 	}
-	if (HasTeam(param.leader_id_))
+	return found;
+}
+
+std::size_t TeamSystem::invite_size_by_team_id(const Guid team_id)
+{
+	const TeamHandle team(team_id);
+	if (!team)
 	{
-		return kRetTeamMemberInTeam;
+		return 0;
 	}
-	if (param.member_list.size() > param.team_type_size_)
+	const auto* const try_invites = tls.registry.try_get<TeamInvites>(team.entity());
+	return nullptr == try_invites ? 0 : try_invites->size();
+}
+
+std::size_t TeamSystem::invite_size_by_player_id(const Guid guid)
+{
+	const auto player = GetPlayer(guid);
+	if (entt::null == player)
 	{
-		return kRetTeamCreateTeamMaxMemberSize;
+		return 0;
 	}
-	RET_CHECK_RETURN(CheckMemberInTeam(param.member_list))
-		const auto team_entity = tls.registry.create();
-	auto& team = tls.registry.emplace<Team>(team_entity);
-	team.leader_id_ = param.leader_id_;
-	team.team_id_ = team_entity;
-	for (const auto& member_it : param.member_list)
+	const auto* const try_invites = tls.registry.try_get<PlayerTeamInvites>(player);
+	return nullptr == try_invites ? 0 : try_invites->size();
+}
+
+bool TeamSystem::IsTeamType(const std::size_t team_type_size)
+{
+	return kFiveMemberMaxSize == team_type_size || kTenMemberMaxSize == team_type_size;
+}
+
+uint32_t TeamSystem::CreateTeam(const CreateTeamP& param)
+{
+	const TeamOpTimer timer(TeamOp::kCreateTeam);
+	return timer.Record(DoCreateTeam(param));
+}
+
+uint32_t TeamSystem::DoCreateTeam(const CreateTeamP& param)
+{
+	if (IsTeamListMax())
 	{
-		AddMember(entt::to_integral(team_entity), member_it);
+		return kRetTeamListMaxSize;
 	}
-	last_team_id_ = entt::to_integral(team_entity);
+	TeamPlayerVector player_list;
+	RET_CHECK_RETURN(CheckCreateTeam(param, player_list))
+	last_team_id_ = CommitCreateTeam(param, player_list);
 	return kOK;
 }
 
-uint32_t TeamSystem::JoinTeam(const Guid team_id, const Guid guid)
+//all or nothing, every team is validated before the first one is created
+uint32_t TeamSystem::CreateTeams(const std::vector<CreateTeamP>& param_list, GuidVector& team_id_list)
+{
+	const TeamOpTimer timer(TeamOp::kCreateTeams);
+	return timer.Record(DoCreateTeams(param_list, team_id_list));
+}
+
+uint32_t TeamSystem::DoCreateTeams(const std::vector<CreateTeamP>& param_list, GuidVector& team_id_list)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
+	if (team_size() + param_list.size() > kMaxTeamSize)
 	{
-		return kRetTeamHasNotTeamId;
+		return kRetTeamListMaxSize;
 	}
-	auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	std::vector<TeamPlayerVector> player_lists(param_list.size());
+	UInt64Set batch_member_list;
+	for (std::size_t i = 0; i < param_list.size(); ++i)
 	{
-		return kRetTeamHasNotTeamId;
+		RET_CHECK_RETURN(CheckCreateTeam(param_list[i], player_lists[i]))
+		if (!batch_member_list.emplace(param_list[i].leader_id_).second)
+		{
+			return kRetTeamMemberInTeam;
+		}
+		for (const auto& player_it : player_lists[i])
+		{
+			if (player_it.guid_ != param_list[i].leader_id_ && !batch_member_list.emplace(player_it.guid_).second)
+			{
+				return kRetTeamMemberInTeam;
+			}
+		}
+	}
+
+	tls.registry.storage<Team>().reserve(team_size() + param_list.size());
+	team_id_list.reserve(team_id_list.size() + param_list.size());
+	for (std::size_t i = 0; i < param_list.size(); ++i)
+	{
+		team_id_list.emplace_back(CommitCreateTeam(param_list[i], player_lists[i]));
+	}
+	if (!param_list.empty())
+	{
+		last_team_id_ = team_id_list.back();
 	}
-	if (HasTeam(guid))
+	return kOK;
+}
+
+uint32_t TeamSystem::CheckCreateTeam(const CreateTeamP& param, TeamPlayerVector& player_list)
+{
+	if (HasTeam(param.leader_id_))
 	{
 		return kRetTeamMemberInTeam;
 	}
-	if (try_team->IsFull())
+	if (!IsTeamType(param.team_type_size_) || param.member_list.size() > param.team_type_size_)
 	{
-		return kRetTeamMembersFull;
+		return kRetTeamCreateTeamMaxMemberSize;
 	}
-	if (const auto applicant_it = std::find(try_team->applicants_.begin(), try_team->applicants_.end(), guid);
-		applicant_it != try_team->applicants_.end())
+	RET_CHECK_RETURN(CheckMemberInTeam(param.member_list, player_list))
+	//a team that cannot add its members, or that is led from outside, would never be erased
+	bool has_leader = false;
+	for (const auto& player_it : player_list)
 	{
-		try_team->applicants_.erase(applicant_it);
+		if (entt::null == player_it.entity_)
+		{
+			return kRetTeamPlayerNotFound;
+		}
+		has_leader = has_leader || player_it.guid_ == param.leader_id_;
 	}
-	AddMember(team_id, guid);
-	return kOK;
+	return has_leader ? kOK : kRetTeamMemberNotInTeam;
 }
 
-uint32_t TeamSystem::JoinTeam(const UInt64Set& member_list, const Guid team_id)
+Guid TeamSystem::CommitCreateTeam(const CreateTeamP& param, const TeamPlayerVector& player_list)
+{
+	const auto team_entity = tls.registry.create();
+	auto& new_team = tls.registry.emplace<Team>(team_entity);
+	new_team.leader_id_ = param.leader_id_;
+	new_team.team_id_ = team_entity;
+	new_team.team_type_size_ = param.team_type_size_;
+	const TeamHandle team(team_entity);
+	journal().OnCreate(team.team_id(), param.leader_id_);
+	for (const auto& player_it : player_list)
+	{
+		AddMember(team, player_it.guid_, player_it.entity_);
+	}
+	UpdateOpenTeam(team);
+	return team.team_id();
+}
+
+uint32_t TeamSystem::JoinTeam(const Guid team_id, const Guid guid)
+{
+	const TeamOpTimer timer(TeamOp::kJoinTeam);
+	const auto player = GetPlayer(guid);
+	if (!Admit(TeamOp::kJoinTeam, entt::to_entity(team_id), player))
+	{
+		return timer.Record(kRetTeamRequestRateLimited);
+	}
+	return timer.Record(DoJoinTeam(TeamHandle(team_id), guid, player));
+}
+
+uint32_t TeamSystem::JoinTeam(const TeamHandle& team, const Guid guid)
+{
+	const TeamOpTimer timer(TeamOp::kJoinTeam);
+	const auto player = GetPlayer(guid);
+	if (!Admit(TeamOp::kJoinTeam, team.entity(), player))
+	{
+		return timer.Record(kRetTeamRequestRateLimited);
+	}
+	return timer.Record(DoJoinTeam(team, guid, player));
+}
+
+uint32_t TeamSystem::DoJoinTeam(const TeamHandle& team, const Guid guid, const entt::entity player)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
+	if (!team)
 	{
 		return kRetTeamHasNotTeamId;
 	}
-	const auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	if (HasTeam(player))
+	{
+		return kRetTeamMemberInTeam;
+	}
+	if (team->IsFull())
+	{
+		return kRetTeamMembersFull;
+	}
+	return AddMember(team, guid, player);
+}
+
+uint32_t TeamSystem::JoinTeam(const UInt64Set& member_list, const Guid team_id)
+{
+	const TeamOpTimer timer(TeamOp::kJoinTeamList);
+	return timer.Record(DoJoinTeam(member_list, team_id));
+}
+
+uint32_t TeamSystem::DoJoinTeam(const UInt64Set& member_list, const Guid team_id)
+{
+	const TeamHandle team(team_id);
+	if (!team)
 	{
 		return kRetTeamHasNotTeamId;
 	}
-	if (try_team->max_member_size() - try_team->member_size() < member_list.size())
+	if (team->max_member_size() - team->member_size() < member_list.size())
+	{
+		return kRetTeamJoinTeamMemberListToMax;
+	}
+
+	if (member_list.size() > TeamMemberVector::capacity())
 	{
 		return kRetTeamJoinTeamMemberListToMax;
 	}
 
-	RET_CHECK_RETURN(CheckMemberInTeam(member_list))
-		for (const auto& member_it : member_list)
+	TeamPlayerVector player_list;
+	RET_CHECK_RETURN(CheckMemberInTeam(member_list, player_list))
+	for (const auto& player_it : player_list)
+	{
+		if (entt::null == player_it.entity_)
 		{
-			RET_CHECK_RETURN(JoinTeam(team_id, member_it))
+			return kRetTeamPlayerNotFound;
 		}
+	}
+	//every member is validated, nothing below can fail so the team is never half joined
+	for (const auto& player_it : player_list)
+	{
+		AddMember(team, player_it.guid_, player_it.entity_);
+	}
 	return kOK;
 }
 
-uint32_t TeamSystem::CheckMemberInTeam(const UInt64Set& member_list)
+//resolves every member once, player_list is filled in member_list order
+uint32_t TeamSystem::CheckMemberInTeam(const UInt64Set& member_list, TeamPlayerVector& player_list)
 {
 	for (const auto& member_it : member_list)
 	{
-		if (HasTeam(member_it))
+		const auto player = GetPlayer(member_it);
+		if (HasTeam(player))
 		{
 			return kRetTeamMemberInTeam;
 		}
+		player_list.emplace_back({ member_it, player });
 	}
 	return kOK;
 }
 
 uint32_t TeamSystem::LeaveTeam(const Guid guid)
 {
-	const auto team_id = GetTeamId(guid);
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
-	{
-		return kRetTeamHasNotTeamId;
-	}
-	auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	const TeamOpTimer timer(TeamOp::kLeaveTeam);
+	const auto player = GetPlayer(guid);
+	return timer.Record(DoLeaveTeam(TeamHandle(GetTeamId(player)), guid, player));
+}
+
+uint32_t TeamSystem::LeaveTeam(const TeamHandle& team, const Guid guid)
+{
+	const TeamOpTimer timer(TeamOp::kLeaveTeam);
+	return timer.Record(DoLeaveTeam(team, guid, GetPlayer(guid)));
+}
+
+uint32_t TeamSystem::DoLeaveTeam(const TeamHandle& team, const Guid guid, const entt::entity player)
+{
+	if (!team)
 	{
 		return kRetTeamHasNotTeamId;
 	}
-	if (!try_team->HasMember(guid))
+	if (!team->HasMember(guid))
 	{
 		return kRetTeamMemberNotInTeam;
 	}
-	const bool is_leader_leave = try_team->IsLeader(guid);
-	DelMember(team_id, guid);
-	if (!try_team->members_.empty() && is_leader_leave)
+	const bool is_leader_leave = team->IsLeader(guid);
+	DelMember(team, guid, player);
+	if (!team->members_.empty() && is_leader_leave)
 	{
-		try_team->OnAppointLeader(*try_team->members_.begin());
+		journal().OnAppointLeader(team.team_id(), guid, team->members_.front());
+		team->OnAppointLeader(team->members_.front());
 	}
-	if (try_team->empty())
+	if (team->empty())
 	{
-		EraseTeam(try_team->to_entity_id());
+		EraseTeam(team);
 	}
 	return kOK;
 }
 
 uint32_t TeamSystem::KickMember(const Guid team_id, const Guid current_leader_id, const Guid be_kick_id)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
-	{
-		return kRetTeamHasNotTeamId;
-	}
-	auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	const TeamOpTimer timer(TeamOp::kKickMember);
+	return timer.Record(DoKickMember(TeamHandle(team_id), current_leader_id, be_kick_id));
+}
+
+uint32_t TeamSystem::KickMember(const TeamHandle& team, const Guid current_leader_id, const Guid be_kick_id)
+{
+	const TeamOpTimer timer(TeamOp::kKickMember);
+	return timer.Record(DoKickMember(team, current_leader_id, be_kick_id));
+}
+
+uint32_t TeamSystem::DoKickMember(const TeamHandle& team, const Guid current_leader_id, const Guid be_kick_id)
+{
+	if (!team)
 	{
 		return kRetTeamHasNotTeamId;
 	}
-	if (try_team->leader_id_ != current_leader_id)
+	if (team->leader_id_ != current_leader_id)
 	{
 		return kRetTeamKickNotLeader;
 	}
-	if (try_team->leader_id_ == be_kick_id)
+	if (team->leader_id_ == be_kick_id)
 	{
 		return kRetTeamKickSelf;
 	}
@@ -427,193 +1165,1156 @@ uint32_t TeamSystem::KickMember(const Guid team_id, const Guid current_leader_id
 	{
 		return kRetTeamKickSelf;
 	}
-	if (!try_team->HasMember(be_kick_id))
+	if (!team->HasMember(be_kick_id))
 	{
 		return kRetTeamMemberNotInTeam;
 	}
-	DelMember(team_id, be_kick_id);
+	DelMember(team, be_kick_id, GetPlayer(be_kick_id));
 	return kOK;
 }
 
 uint32_t TeamSystem::Disbanded(const Guid team_id, const Guid current_leader_id)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
-	{
-		return kRetTeamHasNotTeamId;
-	}
-	auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	const TeamOpTimer timer(TeamOp::kDisbanded);
+	return timer.Record(DoDisbanded(TeamHandle(team_id), current_leader_id));
+}
+
+uint32_t TeamSystem::Disbanded(const TeamHandle& team, const Guid current_leader_id)
+{
+	const TeamOpTimer timer(TeamOp::kDisbanded);
+	return timer.Record(DoDisbanded(team, current_leader_id));
+}
+
+uint32_t TeamSystem::DoDisbanded(const TeamHandle& team, const Guid current_leader_id)
+{
+	if (!team)
 	{
 		return kRetTeamHasNotTeamId;
 	}
-	if (try_team->leader_id() != current_leader_id)
+	if (team->leader_id() != current_leader_id)
 	{
 		return kRetTeamDismissNotLeader;
 	}
-	const auto temp_member = try_team->members_;
-	for (const auto& member_it : temp_member)
-	{
-		DelMember(team_id, member_it);
-	}
-	EraseTeam(team_entity);
+	DisbandTeam(team);
 	return kOK;
 }
 
 uint32_t TeamSystem::DisbandedTeamNoLeader(const Guid team_id)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
+	const TeamOpTimer timer(TeamOp::kDisbandedTeamNoLeader);
+	return timer.Record(DoDisbandedTeamNoLeader(team_id));
+}
+
+uint32_t TeamSystem::DoDisbandedTeamNoLeader(const Guid team_id)
+{
+	const TeamHandle team(team_id);
+	if (!team)
 	{
 		return kRetTeamHasNotTeamId;
 	}
-	const auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	DisbandTeam(team);
+	return kOK;
+}
+
+//all or nothing, fails without disbanding anything if one team id is invalid
+uint32_t TeamSystem::DisbandTeams(const GuidVector& team_id_list)
+{
+	const TeamOpTimer timer(TeamOp::kDisbandTeams);
+	return timer.Record(DoDisbandTeams(team_id_list));
+}
+
+uint32_t TeamSystem::DoDisbandTeams(const GuidVector& team_id_list)
+{
+	for (const auto& team_id : team_id_list)
+	{
+		if (!TeamHandle(team_id))
+		{
+			return kRetTeamHasNotTeamId;
+		}
+	}
+	//handles are resolved again, disbanding a team can move other Team components
+	for (const auto& team_id : team_id_list)
 	{
-		return kRetTeamHasNotTeamId;
+		if (const TeamHandle team(team_id); team)
+		{
+			DisbandTeam(team);
+		}
 	}
-	return Disbanded(team_id, try_team->leader_id());
+	return kOK;
 }
 
-uint32_t TeamSystem::AppointLeader(const Guid team_id, const Guid current_leader_id, const Guid new_leader_id)
+void TeamSystem::DisbandTeam(const TeamHandle& team)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
+	const auto temp_member = team->members_;
+	for (const auto& member_it : temp_member)
 	{
-		return kRetTeamHasNotTeamId;
+		DelMember(team, member_it, GetPlayer(member_it));
 	}
-	auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	EraseTeam(team);
+}
+
+uint32_t TeamSystem::AppointLeader(const Guid team_id, const Guid current_leader_id, const Guid new_leader_id)
+{
+	const TeamOpTimer timer(TeamOp::kAppointLeader);
+	return timer.Record(DoAppointLeader(TeamHandle(team_id), current_leader_id, new_leader_id));
+}
+
+uint32_t TeamSystem::AppointLeader(const TeamHandle& team, const Guid current_leader_id, const Guid new_leader_id)
+{
+	const TeamOpTimer timer(TeamOp::kAppointLeader);
+	return timer.Record(DoAppointLeader(team, current_leader_id, new_leader_id));
+}
+
+uint32_t TeamSystem::DoAppointLeader(const TeamHandle& team, const Guid current_leader_id, const Guid new_leader_id)
+{
+	if (!team)
 	{
 		return kRetTeamHasNotTeamId;
 	}
-	if (try_team->leader_id_ == new_leader_id)
+	if (team->leader_id_ == new_leader_id)
 	{
 		return kRetTeamAppointSelf;
 	}
-	if (!try_team->HasMember(new_leader_id))
+	if (!team->HasMember(new_leader_id))
 	{
 		return kRetTeamHasNotTeamId;
 	}
-	if (try_team->leader_id_ != current_leader_id)
+	if (team->leader_id_ != current_leader_id)
 	{
 		return kRetTeamAppointSelf;
 	}
-	try_team->OnAppointLeader(new_leader_id);
+	journal().OnAppointLeader(team.team_id(), current_leader_id, new_leader_id);
+	team->OnAppointLeader(new_leader_id);
 	return kOK;
 }
 
 uint32_t TeamSystem::ApplyToTeam(Guid team_id, Guid guid)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
+	const TeamOpTimer timer(TeamOp::kApplyToTeam);
+	const auto player = GetPlayer(guid);
+	if (!Admit(TeamOp::kApplyToTeam, entt::to_entity(team_id), player))
 	{
-		return kRetTeamHasNotTeamId;
+		return timer.Record(kRetTeamRequestRateLimited);
 	}
-	auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	return timer.Record(DoApplyToTeam(TeamHandle(team_id), guid, player));
+}
+
+uint32_t TeamSystem::ApplyToTeam(const TeamHandle& team, const Guid guid)
+{
+	const TeamOpTimer timer(TeamOp::kApplyToTeam);
+	const auto player = GetPlayer(guid);
+	if (!Admit(TeamOp::kApplyToTeam, team.entity(), player))
+	{
+		return timer.Record(kRetTeamRequestRateLimited);
+	}
+	return timer.Record(DoApplyToTeam(team, guid, player));
+}
+
+uint32_t TeamSystem::DoApplyToTeam(const TeamHandle& team, const Guid guid, const entt::entity player)
+{
+	if (!team)
 	{
 		return kRetTeamHasNotTeamId;
 	}
-	if (HasTeam(guid))
+	const auto team_id = team.team_id();
+	if (HasTeam(player))
 	{
 		return kRetTeamMemberInTeam;
 	}
-	if (try_team->IsFull())
+	if (team->IsFull())
 	{
 		return kRetTeamMembersFull;
 	}
-	if (try_team->applicants_.size() >= kMaxApplicantSize)
+	if (entt::null == player)
 	{
-		try_team->applicants_.erase(try_team->applicants_.begin());
+		return kRetTeamPlayerNotFound;
+	}
+	auto& applicant_list = tls.registry.get_or_emplace<TeamApplicants>(team.entity()).applicant_list_;
+	if (applicant_list.contains(guid))
+	{
+		return kOK;
+	}
+	if (applicant_list.full())
+	{
+		const auto evicted_guid = applicant_list.pop_front();
+		DelPlayerApplication(evicted_guid, team_id);
+		journal().OnDelApplicant(team_id, evicted_guid);
 	}
-	try_team->applicants_.emplace_back(guid);
+	applicant_list.push_back(guid);
+	journal().OnAddApplicant(team_id, guid);
+	const auto timer_id = timing_wheel().Add(timing_wheel().now() + kTeamApplicantTimeoutMs, { TeamTimerType::kApplicant, team_id, guid });
+	tls.registry.get_or_emplace<PlayerTeamApplications>(player).Add(team_id, timer_id);
 	return kOK;
 }
 
 uint32_t TeamSystem::DelApplicant(Guid team_id, Guid guid)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
-	{
-		return kRetTeamHasNotTeamId;
-	}
-	auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	const TeamOpTimer timer(TeamOp::kDelApplicant);
+	return timer.Record(DoDelApplicant(TeamHandle(team_id), guid));
+}
+
+uint32_t TeamSystem::DelApplicant(const TeamHandle& team, const Guid guid)
+{
+	const TeamOpTimer timer(TeamOp::kDelApplicant);
+	return timer.Record(DoDelApplicant(team, guid));
+}
+
+uint32_t TeamSystem::DoDelApplicant(const TeamHandle& team, const Guid guid)
+{
+	if (!team)
 	{
 		return kRetTeamHasNotTeamId;
 	}
-	if (const auto app_it = std::find(try_team->applicants_.begin(), try_team->applicants_.end(), guid);
-		app_it != try_team->applicants_.end())
+	if (EraseApplicant(team, guid))
 	{
-		try_team->applicants_.erase(app_it);
+		DelPlayerApplication(guid, team.team_id());
+		journal().OnDelApplicant(team.team_id(), guid);
 	}
 	return kOK;
 }
 
 void TeamSystem::ClearApplyList(const Guid team_id)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
+	const TeamHandle team(team_id);
+	if (!team)
 	{
 		return;
 	}
-	auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	const auto* const try_applicants = tls.registry.try_get<TeamApplicants>(team.entity());
+	if (nullptr == try_applicants)
 	{
 		return;
 	}
-	try_team->applicants_.clear();
+	for (const auto& applicant_it : try_applicants->applicant_list_)
+	{
+		DelPlayerApplication(applicant_it, team_id);
+		journal().OnDelApplicant(team_id, applicant_it);
+	}
+	tls.registry.remove<TeamApplicants>(team.entity());
 }
 
-void TeamSystem::EraseTeam(entt::entity team_id)
+bool TeamSystem::EraseApplicant(const TeamHandle& team, const Guid guid)
 {
-	Destroy(tls.registry, team_id);
+	auto* const try_applicants = tls.registry.try_get<TeamApplicants>(team.entity());
+	if (nullptr == try_applicants || !try_applicants->applicant_list_.erase(guid))
+	{
+		return false;
+	}
+	if (try_applicants->applicant_list_.empty())
+	{
+		tls.registry.remove<TeamApplicants>(team.entity());
+	}
+	return true;
 }
 
+uint32_t TeamSystem::WithdrawApplications(const Guid guid)
+{
+	const TeamOpTimer timer(TeamOp::kWithdrawApplications);
+	return timer.Record(DoWithdrawApplications(guid));
+}
 
-uint32_t TeamSystem::AddMember(Guid team_id, Guid guid)
+uint32_t TeamSystem::DoWithdrawApplications(const Guid guid)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
+	const auto player = GetPlayer(guid);
+	if (entt::null == player)
 	{
-		return kRetTeamHasNotTeamId;
+		return kRetTeamPlayerNotFound;
 	}
-	auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	WithdrawApplications(player, guid);
+	return kOK;
+}
+
+uint32_t TeamSystem::InviteToTeam(const Guid team_id, const Guid inviter_id, const Guid guid)
+{
+	const TeamOpTimer timer(TeamOp::kInviteToTeam);
+	return timer.Record(DoInviteToTeam(team_id, inviter_id, guid));
+}
+
+//inviting again keeps the first deadline. a full list on either side drops its oldest invite
+uint32_t TeamSystem::DoInviteToTeam(const Guid team_id, const Guid inviter_id, const Guid guid)
+{
+	const TeamHandle team(team_id);
+	if (!team)
 	{
 		return kRetTeamHasNotTeamId;
 	}
-
-	const auto pit = tlsCommonLogic.GetPlayerList().find(guid);
-	if (pit == tlsCommonLogic.GetPlayerList().end())
+	if (!team->HasMember(inviter_id))
+	{
+		return kRetTeamMemberNotInTeam;
+	}
+	const auto player = GetPlayer(guid);
+	if (entt::null == player)
 	{
 		return kRetTeamPlayerNotFound;
 	}
-	try_team->members_.emplace_back(guid);
-	tls.registry.emplace<TeamId>(pit->second).set_team_id(entt::to_integral(team_id));
+	if (HasTeam(player))
+	{
+		return kRetTeamMemberInTeam;
+	}
+	if (team->IsFull())
+	{
+		return kRetTeamMembersFull;
+	}
+	auto& team_invites = tls.registry.get_or_emplace<TeamInvites>(team.entity());
+	if (nullptr != team_invites.Find(guid))
+	{
+		return kOK;
+	}
+	if (team_invites.full())
+	{
+		DelInvite(team_id, team_invites.front().guid_, true);
+	}
+	if (const auto* const try_player_invites = tls.registry.try_get<PlayerTeamInvites>(player); nullptr != try_player_invites && try_player_invites->full())
+	{
+		DelInvite(try_player_invites->team_list_.front(), guid, true);
+	}
+	//evicting can remove invite components and move the ones left in storage
+	const auto timer_id = timing_wheel().Add(timing_wheel().now() + kTeamInviteTimeoutMs, { TeamTimerType::kInvite, team_id, guid });
+	tls.registry.get_or_emplace<TeamInvites>(team.entity()).invite_list_.emplace_back({ guid, inviter_id, timer_id });
+	tls.registry.get_or_emplace<PlayerTeamInvites>(player).team_list_.emplace_back(team_id);
 	return kOK;
 }
 
-uint32_t TeamSystem::DelMember(Guid team_id, Guid guid)
+uint32_t TeamSystem::AcceptInvite(const Guid team_id, const Guid guid)
+{
+	const TeamOpTimer timer(TeamOp::kAcceptInvite);
+	return timer.Record(DoAcceptInvite(team_id, guid));
+}
+
+//joining drops every invite the player holds, this one included
+uint32_t TeamSystem::DoAcceptInvite(const Guid team_id, const Guid guid)
 {
-	const auto team_entity = entt::to_entity(team_id);
-	if (!tls.registry.valid(team_entity))
+	const TeamHandle team(team_id);
+	if (!team)
 	{
 		return kRetTeamHasNotTeamId;
 	}
-	auto* const try_team = tls.registry.try_get<Team>(team_entity);
-	if (nullptr == try_team)
+	auto* const try_invites = tls.registry.try_get<TeamInvites>(team.entity());
+	if (nullptr == try_invites || nullptr == try_invites->Find(guid))
+	{
+		return kRetTeamInviteNotFound;
+	}
+	return DoJoinTeam(team, guid, GetPlayer(guid));
+}
+
+uint32_t TeamSystem::DeclineInvite(const Guid team_id, const Guid guid)
+{
+	const TeamOpTimer timer(TeamOp::kDeclineInvite);
+	if (!DelInvite(team_id, guid, true))
+	{
+		return timer.Record(kRetTeamInviteNotFound);
+	}
+	return timer.Record(kOK);
+}
+
+bool TeamSystem::DelInvite(const Guid team_id, const Guid guid, const bool cancel_timer)
+{
+	const TeamHandle team(team_id);
+	if (!team)
+	{
+		return false;
+	}
+	auto* const try_invites = tls.registry.try_get<TeamInvites>(team.entity());
+	if (nullptr == try_invites)
+	{
+		return false;
+	}
+	auto* const invite = try_invites->Find(guid);
+	if (nullptr == invite)
+	{
+		return false;
+	}
+	if (cancel_timer)
+	{
+		timing_wheel().Cancel(invite->timer_id_);
+	}
+	try_invites->invite_list_.erase(invite);
+	if (try_invites->empty())
+	{
+		tls.registry.remove<TeamInvites>(team.entity());
+	}
+	const auto player = GetPlayer(guid);
+	if (entt::null == player)
+	{
+		return true;
+	}
+	auto* const try_player_invites = tls.registry.try_get<PlayerTeamInvites>(player);
+	if (nullptr == try_player_invites)
+	{
+		return true;
+	}
+	try_player_invites->Del(team_id);
+	if (try_player_invites->empty())
+	{
+		tls.registry.remove<PlayerTeamInvites>(player);
+	}
+	return true;
+}
+
+//called when the player gets a team
+void TeamSystem::DropPlayerInvites(const entt::entity player, const Guid guid)
+{
+	const auto* const try_player_invites = tls.registry.try_get<PlayerTeamInvites>(player);
+	if (nullptr == try_player_invites)
+	{
+		return;
+	}
+	for (const auto& team_id : try_player_invites->team_list_)
+	{
+		const TeamHandle team(team_id);
+		auto* const try_invites = team ? tls.registry.try_get<TeamInvites>(team.entity()) : nullptr;
+		auto* const invite = nullptr == try_invites ? nullptr : try_invites->Find(guid);
+		if (nullptr == invite)
+		{
+			continue;
+		}
+		timing_wheel().Cancel(invite->timer_id_);
+		try_invites->invite_list_.erase(invite);
+		if (try_invites->empty())
+		{
+			tls.registry.remove<TeamInvites>(team.entity());
+		}
+	}
+	tls.registry.remove<PlayerTeamInvites>(player);
+}
+
+//the team component goes with the entity, only the timers and the player side are dropped here
+void TeamSystem::DropTeamInvites(const TeamHandle& team)
+{
+	const auto* const try_invites = tls.registry.try_get<TeamInvites>(team.entity());
+	if (nullptr == try_invites)
+	{
+		return;
+	}
+	for (const auto& invite_it : try_invites->invite_list_)
+	{
+		timing_wheel().Cancel(invite_it.timer_id_);
+		const auto player = GetPlayer(invite_it.guid_);
+		if (entt::null == player)
+		{
+			continue;
+		}
+		if (auto* const try_player_invites = tls.registry.try_get<PlayerTeamInvites>(player); nullptr != try_player_invites)
+		{
+			try_player_invites->Del(team.team_id());
+			if (try_player_invites->empty())
+			{
+				tls.registry.remove<PlayerTeamInvites>(player);
+			}
+		}
+	}
+}
+
+void TeamSystem::EraseTeam(const TeamHandle& team)
+{
+	if (const auto* const try_applicants = tls.registry.try_get<TeamApplicants>(team.entity()); nullptr != try_applicants)
+	{
+		for (const auto& applicant_it : try_applicants->applicant_list_)
+		{
+			DelPlayerApplication(applicant_it, team.team_id());
+		}
+	}
+	DropTeamInvites(team);
+	if (const auto* const try_raid_link = tls.registry.try_get<TeamRaidLink>(team.entity()); nullptr != try_raid_link)
+	{
+		UnlinkRaidTeam(try_raid_link->raid_id_, team.team_id());
+	}
+	journal().OnDisband(team.team_id());
+	open_team_index().Erase(team.team_id());
+	Destroy(tls.registry, team.entity());
+}
+
+//every member of from_team moves over and from_team is erased, no member is ever without a team.
+//leader_id, a member of either team, leads the merged team
+uint32_t TeamSystem::MergeTeams(const Guid from_team_id, const Guid team_id, const Guid leader_id)
+{
+	const TeamOpTimer timer(TeamOp::kMergeTeams);
+	return timer.Record(DoMergeTeams(TeamHandle(from_team_id), TeamHandle(team_id), leader_id));
+}
+
+uint32_t TeamSystem::DoMergeTeams(const TeamHandle& from_team, const TeamHandle& team, const Guid leader_id)
+{
+	if (!from_team || !team)
 	{
 		return kRetTeamHasNotTeamId;
 	}
-	auto& members_ = try_team->members_;
-	members_.erase(std::find(members_.begin(), members_.end(), guid));
-	const auto pit = tlsCommonLogic.GetPlayerList().find(guid);
-	if (pit == tlsCommonLogic.GetPlayerList().end())
+	if (from_team.team_id() == team.team_id())
 	{
-		return kRetTeamPlayerNotFound;
+		return kRetTeamMemberInTeam;
 	}
-	tls.registry.remove<TeamId>(pit->second);
-	return kOK;
-}
\ No newline at end of file
+	if (!from_team->HasMember(leader_id) && !team->HasMember(leader_id))
+	{
+		return kRetTeamMemberNotInTeam;
+	}
+	if (team->member_size() + from_team->member_size() > team->max_member_size())
+	{
+		return kRetTeamMembersFull;
+	}
+	const auto member_list = from_team->members_;
+	RelinkMembers(from_team, team, member_list);
+	MergeApplicants(from_team, team);
+	if (!team->IsLeader(leader_id))
+	{
+		journal().OnAppointLeader(team.team_id(), team->leader_id(), leader_id);
+		team->OnAppointLeader(leader_id);
+	}
+	EraseTeam(from_team);
+	return kOK;
+}
+
+//all or nothing, fails without moving anyone if one player is not in from_team or team has no room for all of them
+uint32_t TeamSystem::TransferMembers(const Guid from_team_id, const Guid team_id, const UInt64Set& member_list)
+{
+	const TeamOpTimer timer(TeamOp::kTransferMembers);
+	return timer.Record(DoTransferMembers(TeamHandle(from_team_id), TeamHandle(team_id), member_list));
+}
+
+uint32_t TeamSystem::DoTransferMembers(const TeamHandle& from_team, const TeamHandle& team, const UInt64Set& member_list)
+{
+	if (!from_team || !team)
+	{
+		return kRetTeamHasNotTeamId;
+	}
+	if (from_team.team_id() == team.team_id())
+	{
+		return kRetTeamMemberInTeam;
+	}
+	if (member_list.size() > from_team->member_size())
+	{
+		return kRetTeamMemberNotInTeam;
+	}
+	TeamMemberVector transfer_list;
+	for (const auto& member_it : member_list)
+	{
+		if (!from_team->HasMember(member_it))
+		{
+			return kRetTeamMemberNotInTeam;
+		}
+		transfer_list.emplace_back(member_it);
+	}
+	if (team->member_size() + transfer_list.size() > team->max_member_size())
+	{
+		return kRetTeamMembersFull;
+	}
+	RelinkMembers(from_team, team, transfer_list);
+	OnMembersMovedOut(from_team);
+	return kOK;
+}
+
+//moves members between two teams in place, each TeamId is rewritten instead of removed and emplaced again.
+//raid membership only changes when the two teams are not groups of the same raid
+void TeamSystem::RelinkMembers(const TeamHandle& from_team, const TeamHandle& team, const TeamMemberVector& member_list)
+{
+	const auto from_raid_id = GetTeamRaidId(from_team);
+	const auto raid_id = GetTeamRaidId(team);
+	for (const auto& member_it : member_list)
+	{
+		from_team->members_.erase(from_team->members_.find(member_it));
+		journal().OnDelMember(from_team.team_id(), member_it);
+		team->members_.emplace_back(member_it);
+		journal().OnAddMember(team.team_id(), member_it);
+		const auto player = GetPlayer(member_it);
+		if (entt::null != player)
+		{
+			tls.registry.get<TeamId>(player).set_team_id(team.team_id());
+		}
+		if (from_raid_id != raid_id)
+		{
+			if (kInvalidGuid != from_raid_id)
+			{
+				DelRaidMember(from_raid_id, member_it, player);
+			}
+			if (kInvalidGuid != raid_id)
+			{
+				AddRaidMember(raid_id, member_it, player);
+			}
+		}
+	}
+	UpdateOpenTeam(team);
+}
+
+//a team that lost members to another team is erased once empty,
+//otherwise the earliest member left takes over from a leader that moved
+void TeamSystem::OnMembersMovedOut(const TeamHandle& team)
+{
+	if (team->empty())
+	{
+		EraseTeam(team);
+		return;
+	}
+	if (!team->HasMember(team->leader_id()))
+	{
+		journal().OnAppointLeader(team.team_id(), team->leader_id(), team->members_.front());
+		team->OnAppointLeader(team->members_.front());
+	}
+	UpdateOpenTeam(team);
+}
+
+//applicants of from_team apply again to team in arrival order, an applicant of both keeps the place it had in team.
+//the usual apply rules hold, so a full team takes none and a full list evicts its oldest applicants
+void TeamSystem::MergeApplicants(const TeamHandle& from_team, const TeamHandle& team)
+{
+	const auto* const try_applicants = tls.registry.try_get<TeamApplicants>(from_team.entity());
+	if (nullptr == try_applicants)
+	{
+		return;
+	}
+	const auto applicant_list = try_applicants->applicant_list_;
+	tls.registry.remove<TeamApplicants>(from_team.entity());
+	for (const auto& applicant_it : applicant_list)
+	{
+		DelPlayerApplication(applicant_it, from_team.team_id());
+		DoApplyToTeam(team, applicant_it, GetPlayer(applicant_it));
+	}
+}
+
+Guid TeamSystem::GetTeamRaidId(const TeamHandle& team)
+{
+	const auto* const try_raid_link = tls.registry.try_get<TeamRaidLink>(team.entity());
+	return nullptr == try_raid_link ? kInvalidGuid : try_raid_link->raid_id_;
+}
+
+std::size_t TeamSystem::raid_size()
+{
+	return tls.registry.storage<Raid>().size();
+}
+
+std::size_t TeamSystem::raid_member_size(const Guid raid_id)
+{
+	const auto* const raid = TryGetRaid(raid_id);
+	return nullptr == raid ? 0 : raid->member_list_.size();
+}
+
+Guid TeamSystem::GetRaidId(const Guid guid)
+{
+	const auto player = GetPlayer(guid);
+	if (entt::null == player)
+	{
+		return kInvalidGuid;
+	}
+	const auto* const try_raid_link = tls.registry.try_get<PlayerRaidLink>(player);
+	return nullptr == try_raid_link ? kInvalidGuid : try_raid_link->raid_id_;
+}
+
+Guid TeamSystem::get_leader_id_by_raid_id(const Guid raid_id)
+{
+	const auto* const raid = TryGetRaid(raid_id);
+	return nullptr == raid ? kInvalidGuid : raid->leader_id_;
+}
+
+bool TeamSystem::HasRaidMember(const Guid raid_id, const Guid guid)
+{
+	return kInvalidGuid != raid_id && GetRaidId(guid) == raid_id;
+}
+
+const RaidTeamVector& TeamSystem::raid_team_list(const Guid raid_id)
+{
+	static const RaidTeamVector empty_team_list;
+	const auto* const raid = TryGetRaid(raid_id);
+	return nullptr == raid ? empty_team_list : raid->team_list_;
+}
+
+const RaidMemberVector& TeamSystem::raid_member_list(const Guid raid_id)
+{
+	static const RaidMemberVector empty_member_list;
+	const auto* const raid = TryGetRaid(raid_id);
+	return nullptr == raid ? empty_member_list : raid->member_list_;
+}
+
+//the team becomes the first group of a new raid, its leader leads the raid
+uint32_t TeamSystem::CreateRaid(const Guid team_id, const Guid current_leader_id)
+{
+	const TeamOpTimer timer(TeamOp::kCreateRaid);
+	return timer.Record(DoCreateRaid(TeamHandle(team_id), current_leader_id));
+}
+
+uint32_t TeamSystem::DoCreateRaid(const TeamHandle& team, const Guid current_leader_id)
+{
+	if (!team)
+	{
+		return kRetTeamHasNotTeamId;
+	}
+	if (!team->IsLeader(current_leader_id))
+	{
+		return kRetTeamDismissNotLeader;
+	}
+	if (tls.registry.all_of<TeamRaidLink>(team.entity()))
+	{
+		return kRetTeamMemberInTeam;
+	}
+	const auto raid_entity = tls.registry.create();
+	auto& raid = tls.registry.emplace<Raid>(raid_entity);
+	raid.leader_id_ = current_leader_id;
+	LinkRaidTeam(entt::to_integral(raid_entity), raid, team);
+	return kOK;
+}
+
+uint32_t TeamSystem::AddRaidTeam(const Guid raid_id, const Guid current_leader_id, const Guid team_id)
+{
+	const TeamOpTimer timer(TeamOp::kAddRaidTeam);
+	return timer.Record(DoAddRaidTeam(raid_id, current_leader_id, TeamHandle(team_id)));
+}
+
+uint32_t TeamSystem::DoAddRaidTeam(const Guid raid_id, const Guid current_leader_id, const TeamHandle& team)
+{
+	auto* const raid = TryGetRaid(raid_id);
+	if (nullptr == raid || !team)
+	{
+		return kRetTeamHasNotTeamId;
+	}
+	if (!raid->IsLeader(current_leader_id))
+	{
+		return kRetTeamKickNotLeader;
+	}
+	if (tls.registry.all_of<TeamRaidLink>(team.entity()))
+	{
+		return kRetTeamMemberInTeam;
+	}
+	if (raid->team_list_.full())
+	{
+		return kRetTeamMembersFull;
+	}
+	LinkRaidTeam(raid_id, *raid, team);
+	return kOK;
+}
+
+//fills the first group with room, a new group led by the player is opened when every group is full
+uint32_t TeamSystem::JoinRaid(const Guid raid_id, const Guid guid)
+{
+	const TeamOpTimer timer(TeamOp::kJoinRaid);
+	return timer.Record(DoJoinRaid(raid_id, guid));
+}
+
+uint32_t TeamSystem::DoJoinRaid(const Guid raid_id, const Guid guid)
+{
+	auto* const raid = TryGetRaid(raid_id);
+	if (nullptr == raid)
+	{
+		return kRetTeamHasNotTeamId;
+	}
+	const auto player = GetPlayer(guid);
+	if (entt::null == player)
+	{
+		return kRetTeamPlayerNotFound;
+	}
+	if (HasTeam(player))
+	{
+		return kRetTeamMemberInTeam;
+	}
+	for (const auto& team_it : raid->team_list_)
+	{
+		if (const TeamHandle team(team_it); team && !team->IsFull())
+		{
+			return AddMember(team, guid, player);
+		}
+	}
+	if (raid->team_list_.full())
+	{
+		return kRetTeamMembersFull;
+	}
+	if (IsTeamListMax())
+	{
+		return kRetTeamListMaxSize;
+	}
+	const TeamHandle team(CommitCreateTeam({ guid, {} }, {}));
+	LinkRaidTeam(raid_id, *raid, team);
+	return AddMember(team, guid, player);
+}
+
+//moves a raid member to another group of the same raid by relinking it. the player never leaves the raid,
+//so applications, invites and the raid member list are left alone
+uint32_t TeamSystem::MoveRaidMember(const Guid raid_id, const Guid current_leader_id, const Guid guid, const Guid team_id)
+{
+	const TeamOpTimer timer(TeamOp::kMoveRaidMember);
+	return timer.Record(DoMoveRaidMember(raid_id, current_leader_id, guid, TeamHandle(team_id)));
+}
+
+uint32_t TeamSystem::DoMoveRaidMember(const Guid raid_id, const Guid current_leader_id, const Guid guid, const TeamHandle& team)
+{
+	const auto* const raid = TryGetRaid(raid_id);
+	if (nullptr == raid || !team || !raid->team_list_.contains(team.team_id()))
+	{
+		return kRetTeamHasNotTeamId;
+	}
+	if (!raid->IsLeader(current_leader_id))
+	{
+		return kRetTeamKickNotLeader;
+	}
+	const auto player = GetPlayer(guid);
+	if (!HasRaidMember(raid_id, guid))
+	{
+		return kRetTeamMemberNotInTeam;
+	}
+	const TeamHandle from_team(GetTeamId(player));
+	if (from_team.team_id() == team.team_id())
+	{
+		return kRetTeamMemberInTeam;
+	}
+	if (team->IsFull())
+	{
+		return kRetTeamMembersFull;
+	}
+	TeamMemberVector member_list;
+	member_list.emplace_back(guid);
+	RelinkMembers(from_team, team, member_list);
+	OnMembersMovedOut(from_team);
+	return kOK;
+}
+
+uint32_t TeamSystem::AppointRaidLeader(const Guid raid_id, const Guid current_leader_id, const Guid new_leader_id)
+{
+	const TeamOpTimer timer(TeamOp::kAppointRaidLeader);
+	return timer.Record(DoAppointRaidLeader(raid_id, current_leader_id, new_leader_id));
+}
+
+uint32_t TeamSystem::DoAppointRaidLeader(const Guid raid_id, const Guid current_leader_id, const Guid new_leader_id)
+{
+	auto* const raid = TryGetRaid(raid_id);
+	if (nullptr == raid)
+	{
+		return kRetTeamHasNotTeamId;
+	}
+	if (raid->leader_id_ == new_leader_id)
+	{
+		return kRetTeamAppointSelf;
+	}
+	if (!HasRaidMember(raid_id, new_leader_id))
+	{
+		return kRetTeamHasNotTeamId;
+	}
+	if (raid->leader_id_ != current_leader_id)
+	{
+		return kRetTeamAppointSelf;
+	}
+	raid->leader_id_ = new_leader_id;
+	return kOK;
+}
+
+//disbands every group, the raid goes with its last group
+uint32_t TeamSystem::DisbandRaid(const Guid raid_id, const Guid current_leader_id)
+{
+	const TeamOpTimer timer(TeamOp::kDisbandRaid);
+	return timer.Record(DoDisbandRaid(raid_id, current_leader_id));
+}
+
+uint32_t TeamSystem::DoDisbandRaid(const Guid raid_id, const Guid current_leader_id)
+{
+	const auto* const raid = TryGetRaid(raid_id);
+	if (nullptr == raid)
+	{
+		return kRetTeamHasNotTeamId;
+	}
+	if (!raid->IsLeader(current_leader_id))
+	{
+		return kRetTeamDismissNotLeader;
+	}
+	const auto team_list = raid->team_list_;
+	for (const auto& team_it : team_list)
+	{
+		if (const TeamHandle team(team_it); team)
+		{
+			DisbandTeam(team);
+		}
+	}
+	return kOK;
+}
+
+Raid* TeamSystem::TryGetRaid(const Guid raid_id)
+{
+	const auto raid_entity = entt::to_entity(raid_id);
+	if (!tls.registry.valid(raid_entity))
+	{
+		return nullptr;
+	}
+	return tls.registry.try_get<Raid>(raid_entity);
+}
+
+void TeamSystem::LinkRaidTeam(const Guid raid_id, Raid& raid, const TeamHandle& team)
+{
+	raid.team_list_.emplace_back(team.team_id());
+	tls.registry.emplace<TeamRaidLink>(team.entity(), raid_id);
+	for (const auto& member_it : team->members_)
+	{
+		AddRaidMember(raid_id, member_it, GetPlayer(member_it));
+	}
+}
+
+//called once the team is empty, the raid is destroyed with its last group
+void TeamSystem::UnlinkRaidTeam(const Guid raid_id, const Guid team_id)
+{
+	auto* const raid = TryGetRaid(raid_id);
+	if (nullptr == raid)
+	{
+		return;
+	}
+	if (const auto it = raid->team_list_.find(team_id); it != raid->team_list_.end())
+	{
+		raid->team_list_.erase(it);
+	}
+	if (raid->team_list_.empty())
+	{
+		Destroy(tls.registry, entt::to_entity(raid_id));
+	}
+}
+
+void TeamSystem::AddRaidMember(const Guid raid_id, const Guid guid, const entt::entity player)
+{
+	auto* const raid = TryGetRaid(raid_id);
+	if (nullptr == raid)
+	{
+		return;
+	}
+	raid->member_list_.emplace_back(guid);
+	if (entt::null != player)
+	{
+		tls.registry.emplace_or_replace<PlayerRaidLink>(player, raid_id);
+	}
+}
+
+//the earliest member left takes over when the raid leader goes
+void TeamSystem::DelRaidMember(const Guid raid_id, const Guid guid, const entt::entity player)
+{
+	auto* const raid = TryGetRaid(raid_id);
+	if (nullptr == raid)
+	{
+		return;
+	}
+	if (const auto it = raid->member_list_.find(guid); it != raid->member_list_.end())
+	{
+		raid->member_list_.erase(it);
+	}
+	if (raid->IsLeader(guid) && !raid->member_list_.empty())
+	{
+		raid->leader_id_ = raid->member_list_.front();
+	}
+	if (entt::null != player)
+	{
+		tls.registry.remove<PlayerRaidLink>(player);
+	}
+}
+
+TeamDeltaJournal& TeamSystem::journal()
+{
+	thread_local TeamDeltaJournal journal;
+	return journal;
+}
+
+OpenTeamIndex& TeamSystem::open_team_index()
+{
+	thread_local OpenTeamIndex open_team_index;
+	return open_team_index;
+}
+
+//ticks are milliseconds on the caller's clock, deadlines count from the last now_ms passed to UpdateTimers
+TeamTimingWheel& TeamSystem::timing_wheel()
+{
+	thread_local TeamTimingWheel timing_wheel;
+	return timing_wheel;
+}
+
+TeamPendingLinkMap& TeamSystem::pending_link_list()
+{
+	thread_local TeamPendingLinkMap pending_link_list;
+	return pending_link_list;
+}
+
+TeamAdmission& TeamSystem::admission()
+{
+	thread_local TeamAdmission admission;
+	return admission;
+}
+
+//a request needs a token in both the player's and the team's bucket, either one empty rejects it before the team
+//is resolved and neither token is taken. buckets refill on the admission clock, not the team timing wheel
+bool TeamSystem::Admit(const TeamOp op, const entt::entity team_entity, const entt::entity player)
+{
+	auto& admission = TeamSystem::admission();
+	if (!admission.enabled())
+	{
+		return true;
+	}
+	const auto now_ms = admission.now_ms();
+	PlayerTeamRequestBucket* player_bucket = nullptr;
+	if (admission.player_limit().enabled() && entt::null != player)
+	{
+		player_bucket = tls.registry.try_get<PlayerTeamRequestBucket>(player);
+		if (nullptr == player_bucket)
+		{
+			player_bucket = &tls.registry.emplace<PlayerTeamRequestBucket>(player, admission.player_limit(), now_ms);
+		}
+		player_bucket->Refill(admission.player_limit(), now_ms);
+		if (!player_bucket->HasToken())
+		{
+			admission.OnPlayerRejected(op);
+			return false;
+		}
+	}
+	//unknown team ids get no bucket, they fail on the team lookup anyway
+	TeamRequestBucket* team_bucket = nullptr;
+	if (admission.team_limit().enabled() && tls.registry.valid(team_entity) && tls.registry.all_of<Team>(team_entity))
+	{
+		team_bucket = tls.registry.try_get<TeamRequestBucket>(team_entity);
+		if (nullptr == team_bucket)
+		{
+			team_bucket = &tls.registry.emplace<TeamRequestBucket>(team_entity, admission.team_limit(), now_ms);
+		}
+		team_bucket->Refill(admission.team_limit(), now_ms);
+		if (!team_bucket->HasToken())
+		{
+			admission.OnTeamRejected(op);
+			return false;
+		}
+	}
+	if (nullptr != player_bucket)
+	{
+		player_bucket->Take();
+	}
+	if (nullptr != team_bucket)
+	{
+		team_bucket->Take();
+	}
+	return true;
+}
+
+//fires every team timer due by now_ms, each expired entry is removed before on_expire sees it
+template <typename Func>
+void TeamSystem::UpdateTimers(const uint64_t now_ms, Func&& on_expire)
+{
+	timing_wheel().Advance(now_ms, [&on_expire](const TeamTimer& team_timer)
+		{
+			switch (team_timer.type_)
+			{
+			case TeamTimerType::kInvite:
+				DelInvite(team_timer.team_id_, team_timer.guid_, false);
+				break;
+			case TeamTimerType::kApplicant:
+				DoDelApplicant(TeamHandle(team_timer.team_id_), team_timer.guid_);
+				break;
+			}
+			on_expire(team_timer);
+		});
+}
+
+//any team type, teams closest to full come first
+std::size_t TeamSystem::FindOpenTeams(const std::size_t min_free_slots, const std::size_t count, GuidVector& team_id_list, TeamBrowseCursor& cursor)
+{
+	return open_team_index().Find(min_free_slots, 0, count, team_id_list, cursor);
+}
+
+void TeamSystem::UpdateOpenTeam(const TeamHandle& team)
+{
+	open_team_index().Update(team.team_id(), team->max_member_size(), team->member_size());
+}
+
+void TeamSystem::DelPlayerApplication(const Guid guid, const Guid team_id)
+{
+	const auto player = GetPlayer(guid);
+	if (entt::null == player)
+	{
+		return;
+	}
+	auto* const try_applications = tls.registry.try_get<PlayerTeamApplications>(player);
+	if (nullptr == try_applications)
+	{
+		return;
+	}
+	timing_wheel().Cancel(try_applications->Del(team_id));
+	if (try_applications->empty())
+	{
+		tls.registry.remove<PlayerTeamApplications>(player);
+	}
+}
+
+//one pass over the teams the player applied to, called when the player gets a team
+void TeamSystem::WithdrawApplications(const entt::entity player, const Guid guid)
+{
+	const auto* const try_applications = tls.registry.try_get<PlayerTeamApplications>(player);
+	if (nullptr == try_applications)
+	{
+		return;
+	}
+	for (const auto& application_it : try_applications->application_list_)
+	{
+		timing_wheel().Cancel(application_it.timer_id_);
+		if (const TeamHandle team(application_it.team_id_); team && EraseApplicant(team, guid))
+		{
+			journal().OnDelApplicant(application_it.team_id_, guid);
+		}
+	}
+	tls.registry.remove<PlayerTeamApplications>(player);
+}
+
+
+uint32_t TeamSystem::AddMember(const Guid team_id, const Guid guid)
+{
+	return AddMember(TeamHandle(team_id), guid, GetPlayer(guid));
+}
+
+uint32_t TeamSystem::AddMember(const Guid team_id, const Guid guid, const entt::entity player)
+{
+	return AddMember(TeamHandle(team_id), guid, player);
+}
+
+uint32_t TeamSystem::AddMember(const TeamHandle& team, const Guid guid, const entt::entity player)
+{
+	if (!team)
+	{
+		return kRetTeamHasNotTeamId;
+	}
+	if (entt::null == player)
+	{
+		return kRetTeamPlayerNotFound;
+	}
+	if (team->members_.full())
+	{
+		return kRetTeamMembersFull;
+	}
+	team->members_.emplace_back(guid);
+	journal().OnAddMember(team.team_id(), guid);
+	UpdateOpenTeam(team);
+	tls.registry.emplace<TeamId>(player).set_team_id(team.team_id());
+	if (const auto* const try_raid_link = tls.registry.try_get<TeamRaidLink>(team.entity()); nullptr != try_raid_link)
+	{
+		AddRaidMember(try_raid_link->raid_id_, guid, player);
+	}
+	WithdrawApplications(player, guid);
+	DropPlayerInvites(player, guid);
+	return kOK;
+}
+
+uint32_t TeamSystem::DelMember(const Guid team_id, const Guid guid)
+{
+	return DelMember(TeamHandle(team_id), guid, GetPlayer(guid));
+}
+
+uint32_t TeamSystem::DelMember(const Guid team_id, const Guid guid, const entt::entity player)
+{
+	return DelMember(TeamHandle(team_id), guid, player);
+}
+
+uint32_t TeamSystem::DelMember(const TeamHandle& team, const Guid guid, const entt::entity player)
+{
+	if (!team)
+	{
+		return kRetTeamHasNotTeamId;
+	}
+	auto& members_ = team->members_;
+	const auto member_it = members_.find(guid);
+	if (member_it == members_.end())
+	{
+		return kRetTeamMemberNotInTeam;
+	}
+	members_.erase(member_it);
+	journal().OnDelMember(team.team_id(), guid);
+	UpdateOpenTeam(team);
+	if (const auto* const try_raid_link = tls.registry.try_get<TeamRaidLink>(team.entity()); nullptr != try_raid_link)
+	{
+		DelRaidMember(try_raid_link->raid_id_, guid, player);
+	}
+	if (entt::null == player)
+	{
+		return kRetTeamPlayerNotFound;
+	}
+	tls.registry.remove<TeamId>(player);
+	return kOK;
+}
@@ -0,0 +1,566 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "constants/tips_id_constants.h"
+#include "teams/team_command_buffer.h"
+#include "teams/team_role_match.h"
+#include "teams/team_system.h"
+#include "thread_local/storage_common_logic.h"
+
+static constexpr std::size_t kBenchPlayerSize = 50000;
+static constexpr std::size_t kBenchTeamMemberSize = 3;
+
+static std::size_t g_alloc_count = 0;
+
+//every global allocation form is replaced, so array and nothrow allocations are counted too
+//and each delete pairs with the new it belongs to
+static void* CountedAlloc(const std::size_t size) noexcept
+{
+	++g_alloc_count;
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+//kept out of line, gcc flags free() inlined into operator delete as a mismatch with operator new
+[[gnu::noinline]] static void CountedFree(void* p) noexcept
+{
+	std::free(p);
+}
+
+void* operator new(const std::size_t size)
+{
+	if (void* p = CountedAlloc(size))
+	{
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](const std::size_t size)
+{
+	if (void* p = CountedAlloc(size))
+	{
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new(const std::size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAlloc(size);
+}
+
+void* operator new[](const std::size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAlloc(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	CountedFree(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	CountedFree(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	CountedFree(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	CountedFree(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	CountedFree(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	CountedFree(p);
+}
+
+class AllocCounter
+{
+public:
+	explicit AllocCounter(benchmark::State& state) : state_(state), begin_(g_alloc_count) {}
+	~AllocCounter()
+	{
+		state_.counters["allocs/op"] = benchmark::Counter(static_cast<double>(g_alloc_count - begin_),
+			benchmark::Counter::kAvgIterations);
+	}
+
+private:
+	benchmark::State& state_;
+	std::size_t begin_{ 0 };
+};
+
+//xorshift, deterministic across runs so results stay comparable
+class BenchRandom
+{
+public:
+	inline uint64_t Next()
+	{
+		seed_ ^= seed_ << 13;
+		seed_ ^= seed_ >> 7;
+		seed_ ^= seed_ << 17;
+		return seed_;
+	}
+	inline std::size_t Next(const std::size_t bound) { return Next() % bound; }
+
+private:
+	uint64_t seed_{ 0x9E3779B97F4A7C15ull };
+};
+
+//fills the registry with team_count teams of kBenchTeamMemberSize players, the rest of the players stay teamless
+struct BenchTeams
+{
+	explicit BenchTeams(const std::size_t team_count)
+	{
+		team_id_list.reserve(team_count);
+		Guid player_id = 0;
+		for (std::size_t i = 0; i < team_count; ++i)
+		{
+			UInt64Set member_list;
+			for (std::size_t j = 0; j < kBenchTeamMemberSize; ++j)
+			{
+				member_list.emplace(player_id + j);
+			}
+			team_list.CreateTeam({ player_id, member_list });
+			team_id_list.push_back(team_list.last_team_id());
+			player_id += kBenchTeamMemberSize;
+		}
+		for (; player_id < kBenchPlayerSize; ++player_id)
+		{
+			free_player_list.push_back(player_id);
+		}
+	}
+
+	TeamSystem team_list;
+	std::vector<Guid> team_id_list;
+	std::vector<Guid> free_player_list;
+};
+
+static void BM_CreateTeamDisbanded(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize - 1);
+	BenchRandom random;
+	AllocCounter alloc_counter(state);
+	for (auto _ : state)
+	{
+		const Guid leader_id = teams.free_player_list[random.Next(teams.free_player_list.size())];
+		benchmark::DoNotOptimize(teams.team_list.CreateTeam({ leader_id, UInt64Set{ leader_id } }));
+		benchmark::DoNotOptimize(teams.team_list.Disbanded(teams.team_list.last_team_id(), leader_id));
+	}
+}
+BENCHMARK(BM_CreateTeamDisbanded);
+
+//dungeon finder output then maintenance, state.range(0) five member teams per batch
+static void BM_CreateTeamsDisbandTeams(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize - state.range(0));
+	std::vector<CreateTeamP> param_list;
+	for (std::size_t i = 0; i < static_cast<std::size_t>(state.range(0)); ++i)
+	{
+		UInt64Set member_list;
+		for (std::size_t j = 0; j < kFiveMemberMaxSize; ++j)
+		{
+			member_list.emplace(teams.free_player_list[i * kFiveMemberMaxSize + j]);
+		}
+		param_list.push_back({ teams.free_player_list[i * kFiveMemberMaxSize], member_list });
+	}
+	GuidVector team_id_list;
+	AllocCounter alloc_counter(state);
+	for (auto _ : state)
+	{
+		team_id_list.clear();
+		benchmark::DoNotOptimize(teams.team_list.CreateTeams(param_list, team_id_list));
+		benchmark::DoNotOptimize(TeamSystem::DisbandTeams(team_id_list));
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CreateTeamsDisbandTeams)->Arg(16)->Arg(256);
+
+static void BM_JoinLeaveTeam(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize);
+	BenchRandom random;
+	AllocCounter alloc_counter(state);
+	for (auto _ : state)
+	{
+		const Guid team_id = teams.team_id_list[random.Next(teams.team_id_list.size())];
+		const Guid player_id = teams.free_player_list[random.Next(teams.free_player_list.size())];
+		benchmark::DoNotOptimize(TeamSystem::JoinTeam(team_id, player_id));
+		benchmark::DoNotOptimize(TeamSystem::LeaveTeam(player_id));
+	}
+}
+BENCHMARK(BM_JoinLeaveTeam);
+
+static void BM_JoinKickMember(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize);
+	BenchRandom random;
+	AllocCounter alloc_counter(state);
+	for (auto _ : state)
+	{
+		const Guid team_id = teams.team_id_list[random.Next(teams.team_id_list.size())];
+		const Guid player_id = teams.free_player_list[random.Next(teams.free_player_list.size())];
+		benchmark::DoNotOptimize(TeamSystem::JoinTeam(team_id, player_id));
+		benchmark::DoNotOptimize(TeamSystem::KickMember(team_id, TeamSystem::get_leader_id_by_team_id(team_id), player_id));
+	}
+}
+BENCHMARK(BM_JoinKickMember);
+
+static void BM_ApplyToTeam(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize);
+	BenchRandom random;
+	AllocCounter alloc_counter(state);
+	for (auto _ : state)
+	{
+		const Guid team_id = teams.team_id_list[random.Next(teams.team_id_list.size())];
+		const Guid player_id = teams.free_player_list[random.Next(teams.free_player_list.size())];
+		benchmark::DoNotOptimize(TeamSystem::ApplyToTeam(team_id, player_id));
+	}
+}
+BENCHMARK(BM_ApplyToTeam);
+
+static void BM_GetTeamId(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize);
+	BenchRandom random;
+	AllocCounter alloc_counter(state);
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(TeamSystem::GetTeamId(random.Next(kBenchPlayerSize)));
+	}
+}
+BENCHMARK(BM_GetTeamId);
+
+static void BM_HasTeam(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize);
+	BenchRandom random;
+	AllocCounter alloc_counter(state);
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(TeamSystem::HasTeam(random.Next(kBenchPlayerSize)));
+	}
+}
+BENCHMARK(BM_HasTeam);
+
+static void BM_MemberSize(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize);
+	BenchRandom random;
+	AllocCounter alloc_counter(state);
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(TeamSystem::member_size(teams.team_id_list[random.Next(teams.team_id_list.size())]));
+	}
+}
+BENCHMARK(BM_MemberSize);
+
+//half the probes hit, guids past the member count are stale and must not match
+static void BM_HasMember(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize);
+	BenchRandom random;
+	AllocCounter alloc_counter(state);
+	for (auto _ : state)
+	{
+		const auto team_index = random.Next(teams.team_id_list.size());
+		const Guid guid = team_index * kBenchTeamMemberSize + random.Next(kBenchTeamMemberSize * 2);
+		benchmark::DoNotOptimize(TeamSystem::HasMember(teams.team_id_list[team_index], guid));
+	}
+}
+BENCHMARK(BM_HasMember);
+
+//range(0) guids against 64 teams
+static void BM_FindMembers(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize);
+	BenchRandom random;
+	const GuidVector team_id_list(teams.team_id_list.begin(), teams.team_id_list.begin() + 64);
+	GuidVector guid_list;
+	for (int64_t i = 0; i < state.range(0); ++i)
+	{
+		guid_list.emplace_back(random.Next(64 * kBenchTeamMemberSize * 2));
+	}
+	GuidVector team_id_by_guid;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(TeamSystem::FindMembers(guid_list, team_id_list, team_id_by_guid));
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0) * static_cast<int64_t>(team_id_list.size()));
+}
+BENCHMARK(BM_FindMembers)->Arg(16)->Arg(256);
+
+//one audit pass over the whole Team storage
+static void BM_SweepTeams(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize);
+	for (std::size_t i = 0; i < teams.team_id_list.size(); i += 4)
+	{
+		TeamSystem::ApplyToTeam(teams.team_id_list[i], teams.free_player_list[i % teams.free_player_list.size()]);
+	}
+	for (auto _ : state)
+	{
+		std::size_t member_size = 0;
+		tls.registry.view<Team>().each([&member_size](const Team& team) { member_size += team.member_size(); });
+		benchmark::DoNotOptimize(member_size);
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(TeamSystem::team_size()));
+	state.counters["team_bytes"] = static_cast<double>(sizeof(Team));
+}
+BENCHMARK(BM_SweepTeams);
+
+//sign-up burst, range(0) apply and withdraw requests spread over 8 teams in one tick
+static void BM_CommandBufferBurst(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize);
+	BenchRandom random;
+	TeamCommandBuffer command_buffer(teams.team_list);
+	std::vector<TeamCommand> command_list;
+	for (int64_t i = 0; i < state.range(0); ++i)
+	{
+		const auto team_id = teams.team_id_list[random.Next(8)];
+		const auto guid = teams.free_player_list[random.Next(teams.free_player_list.size())];
+		command_list.push_back({ TeamCommandType::kApplyToTeam, static_cast<uint64_t>(i), team_id, guid, kInvalidGuid, {} });
+		command_list.push_back({ TeamCommandType::kDelApplicant, static_cast<uint64_t>(i), team_id, kInvalidGuid, guid, {} });
+	}
+	TeamCommandResultVector result_list;
+	AllocCounter alloc_counter(state);
+	for (auto _ : state)
+	{
+		for (const auto& command : command_list)
+		{
+			command_buffer.Push(command);
+		}
+		command_buffer.Flush(result_list);
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(command_list.size()));
+}
+BENCHMARK(BM_CommandBufferBurst)->Arg(256);
+
+//spam storm, 16 players flood one team with apply and join requests. range(0) 1 turns the admission limits on,
+//the rejected requests then cost a player lookup and a bucket check
+static void BM_ApplySpamStorm(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize);
+	BenchRandom random;
+	auto& admission = TeamSystem::admission();
+	if (state.range(0) > 0)
+	{
+		admission.SetPlayerLimit({ 5, 1 });
+		admission.SetTeamLimit({ 50, 20 });
+	}
+	const auto team_id = teams.team_id_list.front();
+	AllocCounter alloc_counter(state);
+	for (auto _ : state)
+	{
+		const auto guid = teams.free_player_list[random.Next(16)];
+		benchmark::DoNotOptimize(TeamSystem::ApplyToTeam(team_id, guid));
+		benchmark::DoNotOptimize(TeamSystem::JoinTeam(team_id, guid));
+		TeamSystem::LeaveTeam(guid);
+	}
+	state.counters["rejected"] = static_cast<double>(admission.rejected_size());
+	admission.SetPlayerLimit({});
+	admission.SetTeamLimit({});
+}
+BENCHMARK(BM_ApplySpamStorm)->Arg(0)->Arg(1);
+
+//raid of 8 five member groups with one free slot in each, every iteration moves a member into the group with the free slot
+static void BM_MoveRaidMember(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize - kMaxRaidTeamSize);
+	const auto leader_id = teams.free_player_list.front();
+	std::vector<std::vector<Guid>> group_list(kMaxRaidTeamSize);
+	Guid raid_id = kInvalidGuid;
+	for (std::size_t i = 0; i < kMaxRaidTeamSize; ++i)
+	{
+		auto& group = group_list[i];
+		UInt64Set member_list;
+		for (std::size_t j = 0; j < kFiveMemberMaxSize - 1; ++j)
+		{
+			group.push_back(teams.free_player_list[i * kFiveMemberMaxSize + j]);
+			member_list.emplace(group.back());
+		}
+		teams.team_list.CreateTeam({ group.front(), member_list });
+		if (kInvalidGuid == raid_id)
+		{
+			TeamSystem::CreateRaid(teams.team_list.last_team_id(), leader_id);
+			raid_id = TeamSystem::GetRaidId(leader_id);
+			continue;
+		}
+		TeamSystem::AddRaidTeam(raid_id, leader_id, teams.team_list.last_team_id());
+	}
+	const auto team_list = TeamSystem::raid_team_list(raid_id);
+	std::size_t to = 0;
+	for (auto _ : state)
+	{
+		const auto from = (to + 1) % kMaxRaidTeamSize;
+		const auto guid = group_list[from].back();
+		benchmark::DoNotOptimize(TeamSystem::MoveRaidMember(raid_id, leader_id, guid, team_list[to]));
+		group_list[from].pop_back();
+		group_list[to].push_back(guid);
+		to = from;
+	}
+	state.counters["raid_members"] = static_cast<double>(TeamSystem::raid_member_size(raid_id));
+}
+BENCHMARK(BM_MoveRaidMember);
+
+//two ten member teams, 4 members of the first one move to the other team and back in one call each way
+static void BM_TransferMembers(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize - 2);
+	Guid team_id_list[2]{};
+	UInt64Set member_list;
+	for (std::size_t i = 0; i < 2; ++i)
+	{
+		const auto leader_id = teams.free_player_list[i * kFiveMemberMaxSize];
+		teams.team_list.CreateTeam({ leader_id, UInt64Set{ leader_id }, kTenMemberMaxSize });
+		team_id_list[i] = teams.team_list.last_team_id();
+		for (std::size_t j = 1; j < kFiveMemberMaxSize; ++j)
+		{
+			const auto guid = teams.free_player_list[i * kFiveMemberMaxSize + j];
+			TeamSystem::JoinTeam(team_id_list[i], guid);
+			if (0 == i)
+			{
+				member_list.emplace(guid);
+			}
+		}
+	}
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(TeamSystem::TransferMembers(team_id_list[0], team_id_list[1], member_list));
+		benchmark::DoNotOptimize(TeamSystem::TransferMembers(team_id_list[1], team_id_list[0], member_list));
+	}
+	state.SetItemsProcessed(state.iterations() * 2 * static_cast<int64_t>(member_list.size()));
+}
+BENCHMARK(BM_TransferMembers);
+
+//login peak: players without a team apply, join or create, players in a team leave or get kicked,
+//leaders sometimes disband, so the registry stays close to kMaxTeamSize live teams
+static void BM_LoginPeakChurn(benchmark::State& state)
+{
+	BenchTeams teams(kMaxTeamSize - 1);
+	BenchRandom random;
+	AllocCounter alloc_counter(state);
+	for (auto _ : state)
+	{
+		const Guid player_id = random.Next(kBenchPlayerSize);
+		const auto roll = random.Next(100);
+		if (TeamSystem::HasTeam(player_id))
+		{
+			const Guid team_id = TeamSystem::GetTeamId(player_id);
+			const Guid leader_id = TeamSystem::get_leader_id_by_team_id(team_id);
+			if (roll < 60)
+			{
+				benchmark::DoNotOptimize(TeamSystem::LeaveTeam(player_id));
+			}
+			else if (roll < 90 && leader_id != player_id)
+			{
+				benchmark::DoNotOptimize(TeamSystem::KickMember(team_id, leader_id, player_id));
+			}
+			else
+			{
+				benchmark::DoNotOptimize(TeamSystem::Disbanded(team_id, leader_id));
+			}
+			continue;
+		}
+		const Guid team_id = TeamSystem::GetTeamId(random.Next(kBenchPlayerSize));
+		if (roll < 50)
+		{
+			benchmark::DoNotOptimize(TeamSystem::ApplyToTeam(team_id, player_id));
+		}
+		else if (roll < 85)
+		{
+			benchmark::DoNotOptimize(TeamSystem::JoinTeam(team_id, player_id));
+		}
+		else
+		{
+			benchmark::DoNotOptimize(teams.team_list.CreateTeam({ player_id, UInt64Set{ player_id } }));
+		}
+	}
+	state.counters["teams"] = static_cast<double>(TeamSystem::team_size());
+}
+BENCHMARK(BM_LoginPeakChurn);
+
+//every teamless player queues as a solo with one to three roles, one tick forms 1/1/3 teams
+static void BM_RoleMatchTick(benchmark::State& state)
+{
+	BenchTeams teams(0);
+	BenchRandom random;
+	std::vector<uint8_t> role_mask_list;
+	for (std::size_t i = 0; i < teams.free_player_list.size(); ++i)
+	{
+		const auto roll = random.Next(100);
+		role_mask_list.push_back(roll < 15 ? static_cast<uint8_t>(kTeamRoleTank) : roll < 30 ? static_cast<uint8_t>(kTeamRoleHealer)
+			: roll < 90 ? static_cast<uint8_t>(kTeamRoleDps) : static_cast<uint8_t>(1 + random.Next(kTeamRoleAll)));
+	}
+	TeamRoleMatchVector match_list;
+	GuidVector team_id_list;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		TeamRoleMatcher matcher(teams.team_list, TeamRoleCount{ 1, 1, 3 });
+		match_list.clear();
+		state.ResumeTiming();
+		for (std::size_t i = 0; i < teams.free_player_list.size(); ++i)
+		{
+			TeamRoleMemberVector member_list;
+			member_list.emplace_back({ teams.free_player_list[i], role_mask_list[i] });
+			matcher.Enqueue(teams.free_player_list[i], member_list);
+		}
+		matcher.Tick(match_list);
+		state.PauseTiming();
+		team_id_list.clear();
+		for (const auto& match : match_list)
+		{
+			team_id_list.emplace_back(match.team_id_);
+		}
+		TeamSystem::DisbandTeams(team_id_list);
+		state.ResumeTiming();
+	}
+	state.counters["teams"] = static_cast<double>(match_list.size());
+	state.SetItemsProcessed(state.iterations() * teams.free_player_list.size());
+}
+BENCHMARK(BM_RoleMatchTick)->Unit(benchmark::kMillisecond);
+
+//shard shutdown, every team of a full registry torn down at once
+static void BM_ResetTeams(benchmark::State& state)
+{
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		BenchTeams teams(kMaxTeamSize - 1);
+		state.ResumeTiming();
+		TeamSystem::Reset();
+	}
+	state.SetItemsProcessed(state.iterations() * (kMaxTeamSize - 1));
+}
+BENCHMARK(BM_ResetTeams)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv)
+{
+	for (size_t i = 0; i < kBenchPlayerSize; ++i)
+	{
+		tlsCommonLogic.GetPlayerList().emplace(i, tls.registry.create());
+	}
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+	{
+		return 1;
+	}
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -1,12 +1,45 @@
 #include <gtest/gtest.h>
 
 #include "constants/tips_id_constants.h"
+#include "teams/team_command_buffer.h"
+#include "teams/team_quick_join.h"
+#include "teams/team_read_view.h"
+#include "teams/team_role_match.h"
+#include "teams/team_shard.h"
+#include "teams/team_snapshot.h"
 #include "teams/team_system.h"
 #include "thread_local/storage_common_logic.h"
 
+//registers the players [first, last) that main does not, they are dropped again with the scope
+class ScopedPlayers
+{
+public:
+	ScopedPlayers(const Guid first, const Guid last) : first_(first), last_(last)
+	{
+		for (Guid guid = first_; guid < last_; ++guid)
+		{
+			tlsCommonLogic.GetPlayerList().emplace(guid, tls.registry.create());
+		}
+	}
+
+	~ScopedPlayers()
+	{
+		for (Guid guid = first_; guid < last_; ++guid)
+		{
+			tls.registry.destroy(tlsCommonLogic.GetPlayerList().at(guid));
+			tlsCommonLogic.GetPlayerList().erase(guid);
+		}
+	}
+
+private:
+	Guid first_{ 0 };
+	Guid last_{ 0 };
+};
+
 TEST(TeamManger, CreateFullDismiss)
 {
 	TeamSystem team_list;
+	const ScopedPlayers players(2000, kMaxTeamSize + 2);
 
 	typedef std::vector<Guid> PlayerIdsV;
 	PlayerIdsV team_idl_ist;
@@ -31,6 +64,14 @@ TEST(TeamManger, CreateFullDismiss)
 	}
 	EXPECT_EQ(0, team_list.team_size());
 	EXPECT_EQ(0, team_list.players_size());
+
+	//every member has to be a known player and the leader one of them
+	GuidVector team_id_list;
+	EXPECT_EQ(kRetTeamPlayerNotFound, team_list.CreateTeam({ 20000, UInt64Set{ 20000 }}));
+	EXPECT_EQ(kRetTeamPlayerNotFound, team_list.CreateTeams({ { 1, UInt64Set{ 1 } }, { 2, UInt64Set{ 2, 20000 } } }, team_id_list));
+	EXPECT_EQ(kRetTeamMemberNotInTeam, team_list.CreateTeam({ 1, UInt64Set{ 2 }}));
+	EXPECT_TRUE(team_id_list.empty());
+	EXPECT_EQ(0, team_list.team_size());
 }
 
 TEST(TeamManger, TeamSizeTest)
@@ -514,6 +555,1419 @@ TEST(TeamManger, AppointLeaderNotInTeam)
 	}
 }
 
+TEST(TeamManger, ApplicantUniqueOrder)
+{
+	TeamSystem team_list;
+	constexpr Guid member_id = 1001;
+	EXPECT_EQ(kOK, team_list.CreateTeam({ member_id, UInt64Set{member_id}}));
+
+	for (Guid i = 0; i < kMaxApplicantSize; ++i)
+	{
+		EXPECT_EQ(kOK, team_list.ApplyToTeam(team_list.last_team_id(), i));
+		EXPECT_EQ(kOK, team_list.ApplyToTeam(team_list.last_team_id(), i));
+		EXPECT_EQ(i + 1, team_list.applicant_size_by_team_id(team_list.last_team_id()));
+	}
+
+	for (Guid i = 0; i < kMaxApplicantSize; i += 2)
+	{
+		EXPECT_EQ(kOK, team_list.DelApplicant(team_list.last_team_id(), i));
+		EXPECT_FALSE(team_list.IsApplicant(team_list.last_team_id(), i));
+	}
+	EXPECT_EQ(kMaxApplicantSize / 2, team_list.applicant_size_by_team_id(team_list.last_team_id()));
+	EXPECT_EQ(1, team_list.first_applicant(team_list.last_team_id()));
+
+	Guid app = kMaxApplicantSize;
+	for (std::size_t i = 0; i < kMaxApplicantSize / 2; ++i)
+	{
+		EXPECT_EQ(kOK, team_list.ApplyToTeam(team_list.last_team_id(), app++));
+	}
+	EXPECT_EQ(kMaxApplicantSize, team_list.applicant_size_by_team_id(team_list.last_team_id()));
+	EXPECT_EQ(1, team_list.first_applicant(team_list.last_team_id()));
+
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_list.last_team_id(), app));
+	EXPECT_FALSE(team_list.IsApplicant(team_list.last_team_id(), 1));
+	EXPECT_TRUE(team_list.IsApplicant(team_list.last_team_id(), app));
+	EXPECT_EQ(3, team_list.first_applicant(team_list.last_team_id()));
+}
+
+TEST(TeamManger, WithdrawApplications)
+{
+	TeamSystem team_list;
+	std::vector<Guid> team_id_list;
+	for (Guid leader_id = 1; leader_id <= 3; ++leader_id)
+	{
+		EXPECT_EQ(kOK, team_list.CreateTeam({ leader_id, UInt64Set{leader_id}}));
+		team_id_list.push_back(team_list.last_team_id());
+	}
+
+	constexpr Guid applicant_id = 100;
+	for (const auto& team_id : team_id_list)
+	{
+		EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, applicant_id));
+		EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, applicant_id + 1));
+	}
+	EXPECT_EQ(3, team_list.apply_team_size_by_player_id(applicant_id));
+	EXPECT_EQ(3, team_list.apply_team_size_by_player_id(applicant_id + 1));
+
+	EXPECT_EQ(kOK, team_list.DelApplicant(team_id_list[0], applicant_id + 1));
+	EXPECT_EQ(2, team_list.apply_team_size_by_player_id(applicant_id + 1));
+
+	EXPECT_EQ(kOK, team_list.JoinTeam(team_id_list[0], applicant_id));
+	EXPECT_EQ(0, team_list.apply_team_size_by_player_id(applicant_id));
+	for (const auto& team_id : team_id_list)
+	{
+		EXPECT_FALSE(team_list.IsApplicant(team_id, applicant_id));
+	}
+	EXPECT_EQ(1, team_list.applicant_size_by_team_id(team_id_list[1]));
+
+	EXPECT_EQ(kOK, team_list.Disbanded(team_id_list[1], 2));
+	EXPECT_EQ(1, team_list.apply_team_size_by_player_id(applicant_id + 1));
+
+	EXPECT_EQ(kOK, team_list.CreateTeam({ applicant_id + 1, UInt64Set{applicant_id + 1}}));
+	EXPECT_EQ(0, team_list.apply_team_size_by_player_id(applicant_id + 1));
+	EXPECT_EQ(0, team_list.applicant_size_by_team_id(team_id_list[2]));
+}
+
+TEST(TeamManger, PlayerEntityTeamId)
+{
+	TeamSystem team_list;
+	constexpr Guid member_id = 1;
+	const auto player = TeamSystem::GetPlayer(member_id);
+	EXPECT_TRUE(entt::null != player);
+	EXPECT_TRUE(entt::null == TeamSystem::GetPlayer(kInvalidGuid));
+	constexpr entt::entity null_player = entt::null;
+	EXPECT_FALSE(team_list.HasTeam(null_player));
+
+	EXPECT_EQ(kOK, team_list.CreateTeam({ member_id, UInt64Set{member_id}}));
+	EXPECT_TRUE(team_list.HasTeam(player));
+	EXPECT_EQ(team_list.last_team_id(), team_list.GetTeamId(player));
+
+	constexpr Guid join_id = 2;
+	const auto join_player = TeamSystem::GetPlayer(join_id);
+	EXPECT_EQ(kOK, team_list.AddMember(team_list.last_team_id(), join_id, join_player));
+	EXPECT_EQ(team_list.last_team_id(), team_list.GetTeamId(join_player));
+	EXPECT_EQ(kOK, team_list.DelMember(team_list.last_team_id(), join_id, join_player));
+	EXPECT_FALSE(team_list.HasTeam(join_player));
+	EXPECT_EQ(kRetTeamMemberNotInTeam, team_list.DelMember(team_list.last_team_id(), join_id, join_player));
+}
+
+TEST(TeamManger, TeamHandle)
+{
+	TeamSystem team_list;
+	constexpr Guid member_id = 1;
+	EXPECT_FALSE(TeamHandle(kInvalidGuid));
+	EXPECT_EQ(kOK, team_list.CreateTeam({ member_id, UInt64Set{member_id}}));
+
+	const TeamHandle team(team_list.last_team_id());
+	EXPECT_TRUE(team);
+	EXPECT_EQ(team_list.last_team_id(), team.team_id());
+	EXPECT_EQ(member_id, team->leader_id());
+	EXPECT_EQ(kOK, team_list.AddMember(team, 2, TeamSystem::GetPlayer(2)));
+	EXPECT_EQ(2, team->member_size());
+
+	EXPECT_EQ(kOK, team_list.DisbandedTeamNoLeader(team_list.last_team_id()));
+	EXPECT_FALSE(TeamHandle(team_list.last_team_id()));
+	EXPECT_FALSE(team_list.HasTeam(2));
+}
+
+TEST(TeamManger, BatchCreateJoinDisband)
+{
+	TeamSystem team_list;
+	GuidVector team_id_list;
+	std::vector<CreateTeamP> param_list;
+	param_list.push_back({ 1, UInt64Set{ 1, 2 } });
+	param_list.push_back({ 3, UInt64Set{ 3, 2 } });
+	EXPECT_EQ(kRetTeamMemberInTeam, team_list.CreateTeams(param_list, team_id_list));
+	EXPECT_TRUE(team_id_list.empty());
+	EXPECT_EQ(0, team_list.team_size());
+
+	param_list.pop_back();
+	param_list.push_back({ 3, UInt64Set{ 3, 4 } });
+	param_list.push_back({ 5, UInt64Set{ 5 } });
+	EXPECT_EQ(kOK, team_list.CreateTeams(param_list, team_id_list));
+	EXPECT_EQ(3, team_id_list.size());
+	EXPECT_EQ(3, team_list.team_size());
+	EXPECT_EQ(team_id_list[1], team_list.GetTeamId(4));
+	EXPECT_EQ(team_id_list.back(), team_list.last_team_id());
+
+	EXPECT_EQ(kRetTeamMemberInTeam, team_list.JoinTeam(UInt64Set{ 6, 7, 1 }, team_id_list[2]));
+	EXPECT_FALSE(team_list.HasTeam(6));
+	EXPECT_FALSE(team_list.HasTeam(7));
+	EXPECT_EQ(kRetTeamPlayerNotFound, team_list.JoinTeam(UInt64Set{ 6, 7, kInvalidGuid }, team_id_list[2]));
+	EXPECT_EQ(1, team_list.member_size(team_id_list[2]));
+	EXPECT_EQ(kOK, team_list.JoinTeam(UInt64Set{ 6, 7 }, team_id_list[2]));
+	EXPECT_EQ(3, team_list.member_size(team_id_list[2]));
+
+	EXPECT_EQ(kRetTeamHasNotTeamId, team_list.DisbandTeams({ team_id_list[0], kInvalidGuid }));
+	EXPECT_EQ(3, team_list.team_size());
+	EXPECT_EQ(kOK, team_list.DisbandTeams(team_id_list));
+	EXPECT_EQ(0, team_list.team_size());
+	EXPECT_EQ(0, team_list.players_size());
+}
+
+TEST(TeamManger, DeltaJournal)
+{
+	TeamSystem team_list;
+	auto& journal = TeamSystem::journal();
+	journal.set_enabled(true);
+	std::vector<TeamDelta> delta_list;
+	const auto sink = [&delta_list](const TeamDelta& delta) { delta_list.push_back(delta); };
+
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1, UInt64Set{1}}));
+	const auto team_id = team_list.last_team_id();
+	EXPECT_EQ(kOK, team_list.JoinTeam(team_id, 2));
+	EXPECT_EQ(kOK, team_list.JoinTeam(team_id, 3));
+	EXPECT_EQ(kOK, team_list.LeaveTeam(3));
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 4, UInt64Set{4}}));
+	EXPECT_EQ(kOK, team_list.LeaveTeam(4));
+	journal.Flush(sink);
+	ASSERT_EQ(1, delta_list.size());
+	EXPECT_TRUE(delta_list[0].created_);
+	EXPECT_EQ(1, delta_list[0].leader_id_);
+	EXPECT_EQ((GuidVector{ 1, 2 }), delta_list[0].add_members_);
+	EXPECT_TRUE(delta_list[0].del_members_.empty());
+
+	delta_list.clear();
+	EXPECT_EQ(kOK, team_list.JoinTeam(team_id, 3));
+	EXPECT_EQ(kOK, team_list.LeaveTeam(3));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 5));
+	EXPECT_EQ(kOK, team_list.DelApplicant(team_id, 5));
+	EXPECT_EQ(kOK, team_list.AppointLeader(team_id, 1, 2));
+	EXPECT_EQ(kOK, team_list.AppointLeader(team_id, 2, 1));
+	journal.Flush(sink);
+	EXPECT_TRUE(delta_list.empty());
+
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 5));
+	EXPECT_EQ(kOK, team_list.LeaveTeam(1));
+	journal.Flush(sink);
+	ASSERT_EQ(1, delta_list.size());
+	EXPECT_TRUE(delta_list[0].leader_changed_);
+	EXPECT_EQ(2, delta_list[0].leader_id_);
+	EXPECT_EQ((GuidVector{ 1 }), delta_list[0].del_members_);
+	EXPECT_EQ((GuidVector{ 5 }), delta_list[0].add_applicants_);
+
+	delta_list.clear();
+	EXPECT_EQ(kOK, team_list.JoinTeam(team_id, 6));
+	EXPECT_EQ(kOK, team_list.Disbanded(team_id, 2));
+	journal.Flush(sink);
+	ASSERT_EQ(1, delta_list.size());
+	EXPECT_TRUE(delta_list[0].disbanded_);
+	EXPECT_TRUE(delta_list[0].add_members_.empty());
+	journal.set_enabled(false);
+}
+
+TEST(TeamManger, SnapshotRestore)
+{
+	TeamSystem team_list;
+	GuidVector team_id_list;
+	EXPECT_EQ(kOK, team_list.CreateTeams({ { 1, UInt64Set{ 1, 2, 3 } }, { 4, UInt64Set{ 4 } } }, team_id_list));
+	EXPECT_EQ(kOK, team_list.AppointLeader(team_id_list[0], 1, 3));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id_list[0], 10));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id_list[1], 10));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id_list[1], 11));
+
+	std::string buffer;
+	TeamSnapshot::Write(buffer);
+	EXPECT_FALSE(TeamSnapshot::Read(buffer.data(), buffer.size()));
+
+	EXPECT_EQ(kOK, team_list.DisbandTeams(team_id_list));
+	EXPECT_FALSE(TeamSnapshot::Read(buffer.data(), buffer.size() - 1));
+	EXPECT_EQ(0, team_list.team_size());
+
+	TeamIdMap team_id_map;
+	EXPECT_TRUE(TeamSnapshot::Read(buffer.data(), buffer.size(), team_id_map));
+	ASSERT_EQ(2, team_id_map.size());
+	for (auto& team_id : team_id_list)
+	{
+		team_id = team_id_map.at(team_id);
+	}
+	EXPECT_EQ(2, team_list.team_size());
+	EXPECT_EQ(4, team_list.players_size());
+	EXPECT_EQ(3, team_list.get_leader_id_by_team_id(team_id_list[0]));
+	EXPECT_EQ(team_id_list[0], team_list.GetTeamId(2));
+	EXPECT_EQ(team_id_list[1], team_list.GetTeamId(4));
+	EXPECT_EQ(3, team_list.member_size(team_id_list[0]));
+	EXPECT_EQ(10, team_list.first_applicant(team_id_list[1]));
+	EXPECT_EQ(2, team_list.apply_team_size_by_player_id(10));
+
+	EXPECT_EQ(kOK, team_list.JoinTeam(team_id_list[1], 10));
+	EXPECT_FALSE(team_list.IsApplicant(team_id_list[0], 10));
+	EXPECT_EQ(kOK, team_list.LeaveTeam(3));
+	EXPECT_NE(3, team_list.get_leader_id_by_team_id(team_id_list[0]));
+	EXPECT_TRUE(team_list.HasMember(team_id_list[0], team_list.get_leader_id_by_team_id(team_id_list[0])));
+}
+
+TEST(TeamManger, SnapshotRestart)
+{
+	TeamSystem team_list;
+	TeamSystemResetScope reset_scope;
+	auto& player_list = tlsCommonLogic.GetPlayerList();
+	player_list.emplace(3100, tls.registry.create());
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 20, UInt64Set{ 20, 21, 3100 }}));
+	const auto team_id = team_list.last_team_id();
+	std::string buffer;
+	TeamSnapshot::Write(buffer);
+	EXPECT_EQ(kOK, team_list.Disbanded(team_id, 20));
+	tls.registry.destroy(player_list.at(3100));
+	player_list.erase(3100);
+
+	//after a restart the players are registered before the load and can hold the saved team ids,
+	//3100 only registers after the load
+	const auto player = tls.registry.create(entt::to_entity(team_id));
+	player_list.emplace(3000, player);
+	TeamIdMap team_id_map;
+	EXPECT_TRUE(TeamSnapshot::Read(buffer.data(), buffer.size(), team_id_map));
+	const auto new_team_id = team_id_map.at(team_id);
+	EXPECT_NE(team_id, new_team_id);
+	EXPECT_EQ(new_team_id, team_list.GetTeamId(21));
+	EXPECT_EQ(20, team_list.get_leader_id_by_team_id(new_team_id));
+	EXPECT_EQ(1, TeamSnapshot::pending_size());
+
+	player_list.emplace(3100, tls.registry.create());
+	EXPECT_FALSE(team_list.HasTeam(3100));
+	TeamSnapshot::LinkPlayer(3100);
+	EXPECT_EQ(new_team_id, team_list.GetTeamId(3100));
+	EXPECT_EQ(0, TeamSnapshot::pending_size());
+	EXPECT_EQ(kOK, team_list.LeaveTeam(3100));
+
+	//one player in two teams is a corrupt image
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 22, UInt64Set{ 22 }}));
+	TeamSnapshot::Write(buffer);
+	TeamSystem::Reset();
+	const Guid guid = 22;
+	const Guid other_guid = 21;
+	const auto guid_offset = buffer.rfind(std::string(reinterpret_cast<const char*>(&guid), sizeof(guid)));
+	ASSERT_NE(std::string::npos, guid_offset);
+	buffer.replace(guid_offset, sizeof(other_guid), reinterpret_cast<const char*>(&other_guid), sizeof(other_guid));
+	EXPECT_FALSE(TeamSnapshot::Read(buffer.data(), buffer.size()));
+	EXPECT_EQ(0, team_list.team_size());
+
+	for (const Guid registered_guid : { 3000, 3100 })
+	{
+		tls.registry.destroy(player_list.at(registered_guid));
+		player_list.erase(registered_guid);
+	}
+}
+
+TEST(TeamManger, SnapshotRaid)
+{
+	TeamSystem team_list;
+	TeamSystemResetScope reset_scope;
+	auto& player_list = tlsCommonLogic.GetPlayerList();
+	player_list.emplace(3200, tls.registry.create());
+	GuidVector team_id_list;
+	EXPECT_EQ(kOK, team_list.CreateTeams({ { 30, UInt64Set{ 30, 31 } }, { 32, UInt64Set{ 32, 3200 } }, { 34, UInt64Set{ 34 } } }, team_id_list));
+	EXPECT_EQ(kOK, TeamSystem::CreateRaid(team_id_list[0], 30));
+	const auto raid_id = TeamSystem::GetRaidId(30);
+	EXPECT_EQ(kOK, TeamSystem::AddRaidTeam(raid_id, 30, team_id_list[1]));
+	EXPECT_EQ(kOK, TeamSystem::AppointRaidLeader(raid_id, 30, 32));
+	const auto member_list = TeamSystem::raid_member_list(raid_id);
+	std::string buffer;
+	TeamSnapshot::Write(buffer);
+	TeamSystem::Reset();
+	tls.registry.destroy(player_list.at(3200));
+	player_list.erase(3200);
+
+	TeamIdMap team_id_map;
+	EXPECT_TRUE(TeamSnapshot::Read(buffer.data(), buffer.size(), team_id_map));
+	ASSERT_EQ(4, team_id_map.size());
+	const auto new_raid_id = team_id_map.at(raid_id);
+	EXPECT_EQ(new_raid_id, TeamSystem::GetRaidId(31));
+	EXPECT_EQ(32, TeamSystem::get_leader_id_by_raid_id(new_raid_id));
+	const auto& raid_team_list = TeamSystem::raid_team_list(new_raid_id);
+	ASSERT_EQ(2, raid_team_list.size());
+	EXPECT_EQ(team_id_map.at(team_id_list[0]), raid_team_list[0]);
+	EXPECT_EQ(team_id_map.at(team_id_list[1]), raid_team_list[1]);
+	const auto& new_member_list = TeamSystem::raid_member_list(new_raid_id);
+	ASSERT_EQ(member_list.size(), new_member_list.size());
+	for (std::size_t i = 0; i < member_list.size(); ++i)
+	{
+		EXPECT_EQ(member_list[i], new_member_list[i]);
+	}
+	EXPECT_EQ(kInvalidGuid, TeamSystem::GetRaidId(34));
+
+	//3200 gets its team and raid once it registers
+	EXPECT_EQ(1, TeamSnapshot::pending_size());
+	player_list.emplace(3200, tls.registry.create());
+	TeamSnapshot::LinkPlayer(3200);
+	EXPECT_EQ(new_raid_id, TeamSystem::GetRaidId(3200));
+	EXPECT_EQ(kOK, team_list.LeaveTeam(31));
+	EXPECT_FALSE(TeamSystem::HasRaidMember(new_raid_id, 31));
+	EXPECT_EQ(member_list.size() - 1, TeamSystem::raid_member_list(new_raid_id).size());
+	EXPECT_EQ(kOK, TeamSystem::DisbandRaid(new_raid_id, 32));
+	EXPECT_EQ(1, team_list.team_size());
+	EXPECT_EQ(kInvalidGuid, TeamSystem::GetRaidId(3200));
+
+	//links a load left for players that never registered go with a reset
+	TeamSystem::Reset();
+	tls.registry.destroy(player_list.at(3200));
+	player_list.erase(3200);
+	EXPECT_TRUE(TeamSnapshot::Read(buffer.data(), buffer.size()));
+	EXPECT_EQ(1, TeamSnapshot::pending_size());
+	TeamSystem::Reset();
+	EXPECT_EQ(0, TeamSnapshot::pending_size());
+}
+
+TEST(TeamManger, MpscQueue)
+{
+	constexpr std::size_t kProducerSize = 4;
+	constexpr uint64_t kPushSize = 20000;
+	BoundedMpscQueue<uint64_t, 1024> queue;
+	std::vector<std::thread> producer_list;
+	for (std::size_t i = 0; i < kProducerSize; ++i)
+	{
+		producer_list.emplace_back([&queue, i] {
+			for (uint64_t j = 0; j < kPushSize; ++j)
+			{
+				while (!queue.TryPush(i * kPushSize + j))
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+	std::vector<uint64_t> next_list(kProducerSize, 0);
+	uint64_t value = 0;
+	for (std::size_t popped = 0; popped < kProducerSize * kPushSize;)
+	{
+		if (!queue.TryPop(value))
+		{
+			continue;
+		}
+		const auto producer = value / kPushSize;
+		EXPECT_EQ(next_list[producer]++, value % kPushSize);
+		++popped;
+	}
+	for (auto& producer : producer_list)
+	{
+		producer.join();
+	}
+	EXPECT_FALSE(queue.TryPop(value));
+}
+
+static TeamCommandResult WaitReply(TeamReplyQueue& reply_queue)
+{
+	TeamCommandResult result;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (!reply_queue.TryPop(result) && std::chrono::steady_clock::now() < deadline)
+	{
+		std::this_thread::yield();
+	}
+	return result;
+}
+
+TEST(TeamManger, ShardGroup)
+{
+	TeamShardGroup group(2);
+	TeamReplyQueue reply_queue;
+
+	TeamCommand create{ TeamCommandType::kCreateTeam, 1, kInvalidGuid, 10001, kInvalidGuid, {} };
+	create.member_list_.emplace_back(10001);
+	create.reply_queue_ = &reply_queue;
+	EXPECT_TRUE(group.Post(create));
+	auto result = WaitReply(reply_queue);
+	EXPECT_EQ(1, result.request_id_);
+	ASSERT_EQ(kOK, result.ret_);
+	EXPECT_EQ(group.HomeShard(10001), ShardIndexOf(result.team_id_));
+	const auto team_id = result.team_id_;
+
+	EXPECT_TRUE(group.Post({ TeamCommandType::kJoinTeam, 2, team_id, 10002, kInvalidGuid, {}, &reply_queue }));
+	EXPECT_EQ(kOK, WaitReply(reply_queue).ret_);
+	EXPECT_TRUE(group.Post({ TeamCommandType::kJoinTeam, 3, team_id, 10002, kInvalidGuid, {}, &reply_queue }));
+	EXPECT_EQ(kRetTeamMemberInTeam, WaitReply(reply_queue).ret_);
+	EXPECT_TRUE(group.Post({ TeamCommandType::kKickMember, 4, team_id, 10001, 10002, {}, &reply_queue }));
+	EXPECT_EQ(kOK, WaitReply(reply_queue).ret_);
+	EXPECT_TRUE(group.Post({ TeamCommandType::kDisbanded, 5, team_id, 10001, kInvalidGuid, {}, &reply_queue }));
+	result = WaitReply(reply_queue);
+	EXPECT_EQ(5, result.request_id_);
+	EXPECT_EQ(kOK, result.ret_);
+
+	EXPECT_FALSE(group.Post({ TeamCommandType::kJoinTeam, 6, MakeShardTeamId(7, 1), 10002, kInvalidGuid, {} }));
+
+	//the team type goes with the create to the shard
+	TeamCommand ten_create{ TeamCommandType::kCreateTeam, 7, kInvalidGuid, 10030, kInvalidGuid, {}, &reply_queue, kTenMemberMaxSize };
+	ten_create.member_list_.emplace_back(10030);
+	EXPECT_TRUE(group.Post(ten_create));
+	result = WaitReply(reply_queue);
+	ASSERT_EQ(kOK, result.ret_);
+	for (Guid guid = 10031; guid <= 10035; ++guid)
+	{
+		EXPECT_TRUE(group.Post({ TeamCommandType::kJoinTeam, 8, result.team_id_, guid, kInvalidGuid, {}, &reply_queue }));
+		EXPECT_EQ(kOK, WaitReply(reply_queue).ret_);
+	}
+}
+
+TEST(TeamManger, ShardPlayerOwnership)
+{
+	TeamShardGroup group(2);
+	TeamReplyQueue reply_queue;
+	const auto create_team = [&](const uint64_t request_id, const Guid leader_id)
+	{
+		TeamCommand create{ TeamCommandType::kCreateTeam, request_id, kInvalidGuid, leader_id, kInvalidGuid, {} };
+		create.member_list_.emplace_back(leader_id);
+		create.reply_queue_ = &reply_queue;
+		EXPECT_TRUE(group.Post(create));
+		return WaitReply(reply_queue);
+	};
+	const auto post = [&](const TeamCommandType type, const uint64_t request_id, const Guid team_id, const Guid guid)
+	{
+		EXPECT_TRUE(group.Post({ type, request_id, team_id, guid, kInvalidGuid, {}, &reply_queue }));
+		return WaitReply(reply_queue).ret_;
+	};
+
+	auto result = create_team(1, 10010);
+	ASSERT_EQ(kOK, result.ret_);
+	const auto home_team_id = result.team_id_;
+	result = create_team(2, 10011);
+	ASSERT_EQ(kOK, result.ret_);
+	const auto other_team_id = result.team_id_;
+	ASSERT_NE(ShardIndexOf(home_team_id), ShardIndexOf(other_team_id));
+
+	//10010 leads a team on its home shard and cannot join one on the other shard
+	EXPECT_EQ(kRetTeamMemberInTeam, post(TeamCommandType::kJoinTeam, 3, other_team_id, 10010));
+	EXPECT_EQ(kRetTeamMemberInTeam, post(TeamCommandType::kApplyToTeam, 4, other_team_id, 10010));
+
+	//10012 joins a team away from its home shard, then neither shard takes it again until it leaves
+	EXPECT_EQ(kOK, post(TeamCommandType::kJoinTeam, 5, other_team_id, 10012));
+	EXPECT_EQ(kRetTeamMemberInTeam, post(TeamCommandType::kJoinTeam, 6, home_team_id, 10012));
+	EXPECT_EQ(kRetTeamMemberInTeam, create_team(7, 10012).ret_);
+	EXPECT_EQ(kOK, post(TeamCommandType::kLeaveTeam, 8, other_team_id, 10012));
+	EXPECT_EQ(kOK, post(TeamCommandType::kJoinTeam, 9, home_team_id, 10012));
+
+	//a disband gives every member back to its home shard
+	EXPECT_EQ(kOK, post(TeamCommandType::kDisbanded, 10, home_team_id, 10010));
+	EXPECT_EQ(kOK, post(TeamCommandType::kJoinTeam, 11, other_team_id, 10010));
+	EXPECT_EQ(kOK, post(TeamCommandType::kJoinTeam, 12, other_team_id, 10012));
+	EXPECT_FALSE(group.Post({ TeamCommandType::kReserve, 13, other_team_id, 10013, 0, {} }));
+}
+
+static std::atomic<uint64_t> g_shard_now_ms{ 1000 };
+static uint64_t ShardTestClock() { return g_shard_now_ms.load(); }
+
+TEST(TeamManger, ShardApplicationExpire)
+{
+	TeamShardGroup group(2, &ShardTestClock);
+	TeamReplyQueue reply_queue;
+	TeamCommand create{ TeamCommandType::kCreateTeam, 1, kInvalidGuid, 10020, kInvalidGuid, {} };
+	create.member_list_.emplace_back(10020);
+	create.reply_queue_ = &reply_queue;
+	EXPECT_TRUE(group.Post(create));
+	const auto result = WaitReply(reply_queue);
+	ASSERT_EQ(kOK, result.ret_);
+	const auto team_id = result.team_id_;
+	const auto shard_index = ShardIndexOf(team_id);
+	const auto post = [&](const TeamCommandType type, const uint64_t request_id, const Guid guid, const Guid target_id)
+	{
+		EXPECT_TRUE(group.Post({ type, request_id, team_id, guid, target_id, {}, &reply_queue }));
+		return WaitReply(reply_queue).ret_;
+	};
+
+	//the applicant gets a shard local entity that its application keeps
+	EXPECT_EQ(kOK, post(TeamCommandType::kApplyToTeam, 2, 10021, kInvalidGuid));
+	EXPECT_EQ(2, group.player_size(shard_index));
+
+	//a loop that starts after the first command below was taken sees the new time
+	g_shard_now_ms += kTeamApplicantTimeoutMs;
+	EXPECT_EQ(kOK, post(TeamCommandType::kDelApplicant, 3, 10020, 10099));
+	EXPECT_EQ(kOK, post(TeamCommandType::kDelApplicant, 4, 10020, 10099));
+	EXPECT_EQ(1, group.player_size(shard_index));
+}
+
+TEST(TeamManger, ReadView)
+{
+	TeamSystem team_list;
+	auto& journal = TeamSystem::journal();
+	journal.set_enabled(true);
+	TeamReadView view;
+	const auto sink = [&view](const TeamDelta& delta) { view.Apply(delta); };
+
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1, UInt64Set{1}}));
+	const auto team_id = team_list.last_team_id();
+	EXPECT_EQ(kOK, team_list.JoinTeam(team_id, 2));
+	EXPECT_EQ(kInvalidGuid, view.GetTeamId(2));
+	journal.Flush(sink);
+	view.Reclaim();
+	EXPECT_EQ(team_id, view.GetTeamId(2));
+	EXPECT_EQ(1, view.GetLeaderIdByPlayerId(2));
+	EXPECT_TRUE(view.HasMember(team_id, 1));
+
+	std::atomic<bool> running{ true };
+	std::atomic<uint64_t> read_size{ 0 };
+	std::thread reader([&] {
+		TeamReadRecord team;
+		while (running.load(std::memory_order_acquire))
+		{
+			if (view.GetTeam(team_id, team))
+			{
+				EXPECT_TRUE(team.members_.contains(team.leader_id_));
+			}
+			view.GetTeamId(3);
+			read_size.fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+	for (uint32_t i = 0; i < 2000; ++i)
+	{
+		EXPECT_EQ(kOK, team_list.JoinTeam(team_id, 3));
+		if (i % 2 == 0)
+		{
+			journal.Flush(sink);
+			view.Reclaim();
+		}
+		EXPECT_EQ(kOK, team_list.AppointLeader(team_id, team_list.get_leader_id_by_team_id(team_id), 3));
+		journal.Flush(sink);
+		view.Reclaim();
+		EXPECT_EQ(kOK, team_list.AppointLeader(team_id, 3, 1));
+		EXPECT_EQ(kOK, team_list.LeaveTeam(3));
+		journal.Flush(sink);
+		view.Reclaim();
+	}
+	running.store(false, std::memory_order_release);
+	reader.join();
+	EXPECT_GT(read_size.load(), 0);
+	EXPECT_EQ(kInvalidGuid, view.GetTeamId(3));
+
+	EXPECT_EQ(kOK, team_list.Disbanded(team_id, 1));
+	journal.Flush(sink);
+	view.Reclaim();
+	EXPECT_EQ(kInvalidGuid, view.GetTeamId(1));
+	EXPECT_EQ(kInvalidGuid, view.GetLeaderId(team_id));
+
+	//a view created later sees the teams already there, and churn through a small table neither fills it
+	//with tombstones nor drops records
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 4, UInt64Set{4}, kTenMemberMaxSize }));
+	const auto churn_team_id = team_list.last_team_id();
+	journal.Flush([](const TeamDelta&) {});
+	TeamReadView small_view(16, 16);
+	EXPECT_EQ(churn_team_id, small_view.GetTeamId(4));
+	EXPECT_EQ(4, small_view.GetLeaderId(churn_team_id));
+	const auto small_sink = [&small_view](const TeamDelta& delta) { small_view.Apply(delta); };
+	for (Guid guid = 100; guid < 400; ++guid)
+	{
+		EXPECT_EQ(kOK, team_list.JoinTeam(churn_team_id, guid));
+		journal.Flush(small_sink);
+		EXPECT_EQ(kOK, team_list.LeaveTeam(guid));
+		journal.Flush(small_sink);
+		small_view.Reclaim();
+	}
+	EXPECT_EQ(1, small_view.player_size());
+	for (Guid guid = 400; guid < 409; ++guid)
+	{
+		EXPECT_EQ(kOK, team_list.JoinTeam(churn_team_id, guid));
+	}
+	journal.Flush(small_sink);
+	small_view.Reclaim();
+	EXPECT_EQ(10, small_view.player_size());
+	for (Guid guid = 400; guid < 409; ++guid)
+	{
+		EXPECT_EQ(churn_team_id, small_view.GetTeamId(guid));
+	}
+	EXPECT_EQ(kInvalidGuid, small_view.GetTeamId(399));
+	EXPECT_EQ(kOK, team_list.Disbanded(churn_team_id, 4));
+	journal.Flush(small_sink);
+	small_view.Reclaim();
+	EXPECT_EQ(0, small_view.player_size());
+	EXPECT_EQ(0, small_view.team_size());
+	journal.set_enabled(false);
+}
+
+TEST(TeamManger, OpenTeamIndex)
+{
+	TeamSystem team_list;
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1500, UInt64Set{1500}}));
+	const auto team_id = team_list.last_team_id();
+	const auto contains = [](const GuidVector& team_id_list, const Guid team_id) { return std::find(team_id_list.begin(), team_id_list.end(), team_id) != team_id_list.end(); };
+
+	GuidVector team_id_list;
+	TeamBrowseCursor cursor;
+	while (!cursor.finished())
+	{
+		TeamSystem::FindOpenTeams(4, 3, team_id_list, cursor);
+	}
+	EXPECT_TRUE(contains(team_id_list, team_id));
+
+	for (Guid guid = 1501; guid < 1505; ++guid)
+	{
+		EXPECT_EQ(kOK, team_list.JoinTeam(team_id, guid));
+	}
+	team_id_list.clear();
+	cursor = TeamBrowseCursor{};
+	while (!cursor.finished())
+	{
+		TeamSystem::FindOpenTeams(1, 100, team_id_list, cursor);
+	}
+	EXPECT_FALSE(contains(team_id_list, team_id));
+	EXPECT_EQ(kOK, team_list.LeaveTeam(1504));
+	team_id_list.clear();
+	cursor = TeamBrowseCursor{};
+	EXPECT_EQ(1, TeamSystem::FindOpenTeams(1, 1, team_id_list, cursor));
+	EXPECT_EQ(team_id, team_id_list[0]);
+	EXPECT_EQ(kOK, team_list.Disbanded(team_id, 1500));
+
+	//paging keeps its place while other teams enter and leave the bucket
+	TeamBrowseIndex<kTenMemberMaxSize> index;
+	for (Guid id = 1; id <= 6; ++id)
+	{
+		index.Update(id, 5, 3);
+	}
+	team_id_list.clear();
+	cursor = TeamBrowseCursor{};
+	EXPECT_EQ(2, index.Find(2, 5, 2, team_id_list, cursor));
+	index.Erase(2);
+	index.Update(1, 5, 5);
+	index.Update(7, 5, 3);
+	EXPECT_EQ(2, index.Find(2, 5, 2, team_id_list, cursor));
+	EXPECT_EQ(3, index.Find(2, 5, 10, team_id_list, cursor));
+	EXPECT_TRUE(cursor.finished());
+	EXPECT_EQ((GuidVector{ 1, 2, 3, 4, 5, 6, 7 }), team_id_list);
+	EXPECT_EQ(0, index.bucket_size(5, 5));
+	EXPECT_EQ(5, index.bucket_size(2, 5));
+
+	team_id_list.clear();
+	cursor = TeamBrowseCursor{};
+	index.Update(8, 10, 1);
+	EXPECT_EQ(1, index.Find(3, 0, 10, team_id_list, cursor));
+	EXPECT_EQ(8, team_id_list[0]);
+}
+
+TEST(TeamManger, QuickJoin)
+{
+	TeamSystem team_list;
+	TeamQuickJoin quick_join(team_list);
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1600, UInt64Set{1600, 1601, 1602}}));
+	const auto team_id = team_list.last_team_id();
+
+	EXPECT_EQ(kRetTeamMemberInTeam, quick_join.Enqueue(1601, kFiveMemberMaxSize));
+	EXPECT_EQ(kRetTeamPlayerNotFound, quick_join.Enqueue(9999, kFiveMemberMaxSize));
+	EXPECT_EQ(kRetTeamCreateTeamMaxMemberSize, quick_join.Enqueue(1610, kTenMemberMaxSize + 1));
+	for (Guid guid = 1610; guid < 1618; ++guid)
+	{
+		EXPECT_EQ(kOK, quick_join.Enqueue(guid, kFiveMemberMaxSize));
+	}
+	EXPECT_EQ(kOK, quick_join.Enqueue(1610, kFiveMemberMaxSize));
+	quick_join.Dequeue(1617);
+	EXPECT_EQ(7, quick_join.size());
+
+	//other teams left behind by earlier tests may be filled first, only the placements are checked
+	QuickJoinPlacementVector placement_list;
+	quick_join.Tick(placement_list);
+	EXPECT_EQ(7, placement_list.size() + quick_join.size());
+	EXPECT_LE(quick_join.size(), 1);
+	for (const auto& placement : placement_list)
+	{
+		EXPECT_EQ(placement.team_id_, team_list.GetTeamId(placement.guid_));
+	}
+	EXPECT_FALSE(team_list.HasTeam(1617));
+
+	for (const auto& placement : placement_list)
+	{
+		team_list.LeaveTeam(placement.guid_);
+	}
+	EXPECT_EQ(kOK, team_list.Disbanded(team_id, 1600));
+}
+
+TEST(TeamManger, QuickJoinLogout)
+{
+	TeamSystem team_list;
+	TeamSystemResetScope reset_scope;
+	TeamQuickJoin quick_join(team_list);
+	for (Guid guid = 1640; guid < 1643; ++guid)
+	{
+		EXPECT_EQ(kOK, quick_join.Enqueue(guid, kFiveMemberMaxSize));
+	}
+
+	//1640 logs out while queued and is neither placed nor made leader
+	auto& player_list = tlsCommonLogic.GetPlayerList();
+	const auto player = player_list.at(1640);
+	player_list.erase(1640);
+	QuickJoinPlacementVector placement_list;
+	quick_join.Tick(placement_list);
+	player_list.emplace(1640, player);
+	ASSERT_EQ(2, placement_list.size());
+	EXPECT_EQ(0, quick_join.size());
+	const auto team_id = placement_list[0].team_id_;
+	EXPECT_EQ(2, team_list.member_size(team_id));
+	EXPECT_TRUE(team_list.HasMember(team_id, team_list.get_leader_id_by_team_id(team_id)));
+	for (const auto& placement : placement_list)
+	{
+		EXPECT_NE(1640, placement.guid_);
+		EXPECT_TRUE(team_list.HasMember(placement.team_id_, placement.guid_));
+	}
+}
+
+TEST(TeamManger, QuickJoinRegistryFull)
+{
+	TeamSystem team_list;
+	TeamSystemResetScope reset_scope;
+	TeamQuickJoin quick_join(team_list);
+	const ScopedPlayers players(100000, 100000 + kMaxTeamSize);
+	for (Guid guid = 100000; team_list.team_size() < kMaxTeamSize - 1; ++guid)
+	{
+		EXPECT_EQ(kOK, team_list.CreateTeam({ guid, UInt64Set{guid}}));
+	}
+	for (Guid guid = 1620; guid < 1632; ++guid)
+	{
+		EXPECT_EQ(kOK, quick_join.Enqueue(guid, kTenMemberMaxSize));
+	}
+
+	//room for one of the two teams, the other one waits for the next tick
+	QuickJoinPlacementVector placement_list;
+	quick_join.Tick(placement_list);
+	EXPECT_EQ(kTenMemberMaxSize, placement_list.size());
+	EXPECT_EQ(2, quick_join.size());
+	EXPECT_EQ(1, quick_join.registry_full_size());
+	EXPECT_TRUE(team_list.IsTeamListMax());
+}
+
+TEST(TeamManger, RoleMatch)
+{
+	TeamSystem team_list;
+	TeamRoleMatcher matcher(team_list, TeamRoleCount{ 1, 1, 3 });
+	const auto solo = [](const Guid guid, const uint8_t role_mask) { TeamRoleMemberVector member_list; member_list.emplace_back({ guid, role_mask }); return member_list; };
+
+	EXPECT_EQ(kOK, matcher.Enqueue(1700, solo(1700, kTeamRoleTank)));
+	EXPECT_EQ(kOK, matcher.Enqueue(1701, solo(1701, kTeamRoleTank)));
+	EXPECT_EQ(kOK, matcher.Enqueue(1702, solo(1702, kTeamRoleHealer)));
+	for (Guid guid = 1703; guid < 1709; ++guid)
+	{
+		EXPECT_EQ(kOK, matcher.Enqueue(guid, solo(guid, kTeamRoleDps)));
+	}
+	EXPECT_EQ(kOK, matcher.Enqueue(1709, solo(1709, kTeamRoleTank | kTeamRoleHealer)));
+	EXPECT_EQ(kRetTeamPlayerNotFound, matcher.Enqueue(9999, solo(9999, kTeamRoleDps)));
+
+	TeamRoleMemberVector party;
+	party.emplace_back({ 1710, kTeamRoleDps });
+	party.emplace_back({ 1711, kTeamRoleHealer | kTeamRoleDps });
+	EXPECT_EQ(kRetTeamMemberNotInTeam, matcher.Enqueue(1712, party));
+	EXPECT_EQ(kOK, matcher.Enqueue(1710, party));
+	EXPECT_EQ(kRetTeamMemberInTeam, matcher.Enqueue(1711, solo(1711, kTeamRoleDps)));
+	EXPECT_EQ(12, matcher.size());
+
+	TeamRoleMatchVector match_list;
+	matcher.Tick(match_list);
+	ASSERT_EQ(2, match_list.size());
+	EXPECT_EQ(1710, team_list.get_leader_id_by_team_id(match_list[0].team_id_));
+	EXPECT_TRUE(team_list.HasMember(match_list[0].team_id_, 1700));
+	EXPECT_TRUE(team_list.HasMember(match_list[0].team_id_, 1711));
+	EXPECT_TRUE(team_list.HasMember(match_list[1].team_id_, 1701));
+	EXPECT_TRUE(team_list.HasMember(match_list[1].team_id_, 1702));
+	for (const auto& match : match_list)
+	{
+		EXPECT_EQ(5, team_list.member_size(match.team_id_));
+		TeamRoleCount role_count{};
+		for (const auto& member_it : match.member_list_)
+		{
+			++role_count[kTeamRoleTank == member_it.role_mask_ ? 0 : kTeamRoleHealer == member_it.role_mask_ ? 1 : 2];
+		}
+		EXPECT_EQ((TeamRoleCount{ 1, 1, 3 }), role_count);
+	}
+	EXPECT_EQ(2, matcher.size());
+	EXPECT_EQ(0, matcher.party_size());
+
+	EXPECT_EQ(kOK, matcher.Enqueue(1712, solo(1712, kTeamRoleHealer)));
+	for (Guid guid = 1713; guid < 1715; ++guid)
+	{
+		EXPECT_EQ(kOK, matcher.Enqueue(guid, solo(guid, kTeamRoleDps)));
+	}
+	match_list.clear();
+	matcher.Tick(match_list);
+	ASSERT_EQ(1, match_list.size());
+	EXPECT_TRUE(team_list.HasMember(match_list[0].team_id_, 1709));
+	EXPECT_EQ(0, matcher.size());
+
+
+	//the tank pick takes the only healer, so it swaps to healer and the tank/dps player tanks
+	EXPECT_EQ(kOK, matcher.Enqueue(1715, solo(1715, kTeamRoleTank | kTeamRoleHealer)));
+	EXPECT_EQ(kOK, matcher.Enqueue(1716, solo(1716, kTeamRoleTank | kTeamRoleDps)));
+	for (Guid guid = 1717; guid < 1720; ++guid)
+	{
+		EXPECT_EQ(kOK, matcher.Enqueue(guid, solo(guid, kTeamRoleDps)));
+	}
+	match_list.clear();
+	matcher.Tick(match_list);
+	ASSERT_EQ(1, match_list.size());
+	EXPECT_EQ(5, team_list.member_size(match_list[0].team_id_));
+	for (const auto& member_it : match_list[0].member_list_)
+	{
+		EXPECT_EQ(1715 == member_it.guid_ ? kTeamRoleHealer : 1716 == member_it.guid_ ? kTeamRoleTank : kTeamRoleDps, member_it.role_mask_);
+	}
+	EXPECT_EQ(0, matcher.size());
+
+
+	//a player who logs out while queued is dropped instead of being put in a team
+	EXPECT_EQ(kOK, matcher.Enqueue(1720, solo(1720, kTeamRoleTank)));
+	EXPECT_EQ(kOK, matcher.Enqueue(1721, solo(1721, kTeamRoleTank)));
+	EXPECT_EQ(kOK, matcher.Enqueue(1722, solo(1722, kTeamRoleHealer)));
+	for (Guid guid = 1723; guid < 1726; ++guid)
+	{
+		EXPECT_EQ(kOK, matcher.Enqueue(guid, solo(guid, kTeamRoleDps)));
+	}
+	auto& player_list = tlsCommonLogic.GetPlayerList();
+	const auto player = player_list.at(1720);
+	player_list.erase(1720);
+	match_list.clear();
+	matcher.Tick(match_list);
+	player_list.emplace(1720, player);
+	ASSERT_EQ(1, match_list.size());
+	EXPECT_FALSE(team_list.HasMember(match_list[0].team_id_, 1720));
+	EXPECT_TRUE(team_list.HasMember(match_list[0].team_id_, 1721));
+	EXPECT_EQ(5, team_list.member_size(match_list[0].team_id_));
+	EXPECT_FALSE(matcher.IsQueued(1720));
+	EXPECT_EQ(0, matcher.size());
+
+	for (Guid guid = 1700; guid < 1726; ++guid)
+	{
+		team_list.LeaveTeam(guid);
+	}
+}
+
+TEST(TeamManger, Metrics)
+{
+	for (const uint64_t value : std::vector<uint64_t>{ 0, 7, 8, 15, 16, 1000, 123456789, UINT64_MAX })
+	{
+		const auto bucket = TeamLatencyBucket(value);
+		EXPECT_LT(bucket, kTeamLatencyBucketSize);
+		EXPECT_LE(TeamLatencyBucketValue(bucket), value);
+		EXPECT_EQ(bucket, TeamLatencyBucket(TeamLatencyBucketValue(bucket)));
+	}
+
+	const auto before = TeamMetrics::Snapshot();
+	TeamSystem team_list;
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1800, UInt64Set{1800}}));
+	const auto team_id = team_list.last_team_id();
+	EXPECT_EQ(kOK, team_list.JoinTeam(team_id, 1801));
+	EXPECT_EQ(kRetTeamMemberInTeam, team_list.JoinTeam(team_id, 1801));
+	std::thread other_thread([] { EXPECT_EQ(kRetTeamHasNotTeamId, TeamSystem::JoinTeam(kInvalidGuid, 1802)); });
+	other_thread.join();
+	EXPECT_EQ(kOK, team_list.Disbanded(team_id, 1800));
+
+	const auto after = TeamMetrics::Snapshot();
+	const auto& join_after = after[TeamOp::kJoinTeam];
+#ifndef TEAM_METRICS_DISABLED
+	const auto& join_before = before[TeamOp::kJoinTeam];
+	EXPECT_EQ(3, join_after.count_ - join_before.count_);
+	EXPECT_EQ(1, join_after.ret_count(kOK) - join_before.ret_count(kOK));
+	EXPECT_EQ(1, join_after.ret_count(kRetTeamMemberInTeam) - join_before.ret_count(kRetTeamMemberInTeam));
+	EXPECT_EQ(1, join_after.ret_count(kRetTeamHasNotTeamId) - join_before.ret_count(kRetTeamHasNotTeamId));
+	EXPECT_EQ(1, after[TeamOp::kCreateTeam].count_ - before[TeamOp::kCreateTeam].count_);
+	EXPECT_LE(join_after.Percentile(0.5), join_after.max_ticks_);
+	EXPECT_GT(after.ns_per_tick_, 0.0);
+
+	std::string buffer;
+	after.Write(buffer);
+	EXPECT_NE(std::string::npos, buffer.find("JoinTeam count="));
+#else
+	EXPECT_EQ(0, join_after.count_);
+#endif
+}
+
+TEST(TeamManger, TeamType)
+{
+	TeamSystem team_list;
+	EXPECT_FALSE(TeamSystem::IsTeamType(7));
+	EXPECT_EQ(kRetTeamCreateTeamMaxMemberSize, team_list.CreateTeam({ 1900, UInt64Set{1900}, 7 }));
+	EXPECT_TRUE(TeamSystem::IsTeamType(kTenMemberMaxSize));
+
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1900, UInt64Set{1900}, kTenMemberMaxSize }));
+	const auto team_id = team_list.last_team_id();
+	for (Guid guid = 1901; guid < 1900 + kTenMemberMaxSize; ++guid)
+	{
+		EXPECT_EQ(kOK, team_list.JoinTeam(team_id, guid));
+	}
+	EXPECT_EQ(kTenMemberMaxSize, team_list.member_size(team_id));
+	EXPECT_TRUE(team_list.IsTeamFull(team_id));
+	EXPECT_EQ(kRetTeamMembersFull, team_list.JoinTeam(team_id, 1910));
+	EXPECT_EQ(kOK, team_list.Disbanded(team_id, 1900));
+}
+
+TEST(TeamManger, Reset)
+{
+	TeamSystem team_list;
+	{
+		TeamSystemResetScope reset_scope;
+		EXPECT_EQ(0, team_list.team_size());
+		for (Guid guid = 0; guid < 100; guid += 2)
+		{
+			EXPECT_EQ(kOK, team_list.CreateTeam({ guid, UInt64Set{guid, guid + 1}}));
+		}
+		const auto team_id = team_list.last_team_id();
+		EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 200));
+		EXPECT_EQ(50, team_list.team_size());
+		EXPECT_EQ(100, team_list.players_size());
+	}
+	EXPECT_EQ(0, team_list.team_size());
+	EXPECT_EQ(0, team_list.players_size());
+	EXPECT_EQ(0, team_list.apply_team_size_by_player_id(200));
+	EXPECT_EQ(0, TeamSystem::open_team_index().size());
+	EXPECT_FALSE(team_list.HasTeam(1));
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1, UInt64Set{1}}));
+	EXPECT_EQ(1, team_list.team_size());
+	TeamSystem::Reset();
+}
+
+TEST(TeamManger, TimingWheel)
+{
+	TimingWheel<int> timing_wheel;
+	std::vector<int> fired;
+	const auto on_expire = [&fired](const int value) { fired.emplace_back(value); };
+	timing_wheel.Add(70000, 3);
+	timing_wheel.Add(300, 2);
+	timing_wheel.Add(5, 1);
+	const auto cancel_id = timing_wheel.Add(1000, 4);
+	EXPECT_EQ(4, timing_wheel.size());
+	EXPECT_TRUE(timing_wheel.Cancel(cancel_id));
+	EXPECT_FALSE(timing_wheel.Cancel(cancel_id));
+	timing_wheel.Advance(4, on_expire);
+	EXPECT_TRUE(fired.empty());
+	timing_wheel.Advance(299, on_expire);
+	EXPECT_EQ(std::vector<int>{1}, fired);
+	timing_wheel.Advance(69999, on_expire);
+	EXPECT_EQ((std::vector<int>{1, 2}), fired);
+	timing_wheel.Advance(70000, on_expire);
+	EXPECT_EQ((std::vector<int>{1, 2, 3}), fired);
+	EXPECT_TRUE(timing_wheel.empty());
+	//a long gap with timers spread over every level
+	fired.clear();
+	timing_wheel.Add(uint64_t{ 1 } << 30, 7);
+	timing_wheel.Add(timing_wheel.now() + 1, 5);
+	timing_wheel.Add(1 << 20, 6);
+	timing_wheel.Advance(uint64_t{ 1 } << 31, on_expire);
+	EXPECT_EQ((std::vector<int>{5, 6, 7}), fired);
+	EXPECT_EQ(uint64_t{ 1 } << 31, timing_wheel.now());
+}
+
+TEST(TeamManger, Invite)
+{
+	TeamSystem team_list;
+	TeamSystemResetScope reset_scope;
+	const auto now = TeamSystem::timing_wheel().now();
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1, UInt64Set{1, 2}}));
+	const auto team_id = team_list.last_team_id();
+	EXPECT_EQ(kRetTeamHasNotTeamId, team_list.InviteToTeam(team_id + 1, 1, 10));
+	EXPECT_EQ(kRetTeamMemberNotInTeam, team_list.InviteToTeam(team_id, 3, 10));
+	EXPECT_EQ(kRetTeamMemberInTeam, team_list.InviteToTeam(team_id, 1, 2));
+	EXPECT_EQ(kRetTeamInviteNotFound, team_list.AcceptInvite(team_id, 10));
+	EXPECT_EQ(kOK, team_list.InviteToTeam(team_id, 2, 10));
+	EXPECT_EQ(kOK, team_list.InviteToTeam(team_id, 1, 10));
+	EXPECT_TRUE(team_list.IsInvited(team_id, 10));
+	EXPECT_EQ(1, team_list.invite_size_by_team_id(team_id));
+	EXPECT_EQ(kOK, team_list.AcceptInvite(team_id, 10));
+	EXPECT_TRUE(team_list.HasMember(team_id, 10));
+	EXPECT_EQ(0, team_list.invite_size_by_player_id(10));
+	EXPECT_EQ(0, team_list.invite_size_by_team_id(team_id));
+	EXPECT_TRUE(TeamSystem::timing_wheel().empty());
+
+	//the oldest invite is dropped on both sides when a list is full
+	for (Guid guid = 100; guid < 100 + kMaxTeamInviteSize + 1; ++guid)
+	{
+		EXPECT_EQ(kOK, team_list.InviteToTeam(team_id, 1, guid));
+	}
+	EXPECT_EQ(kMaxTeamInviteSize, team_list.invite_size_by_team_id(team_id));
+	EXPECT_FALSE(team_list.IsInvited(team_id, 100));
+	EXPECT_EQ(0, team_list.invite_size_by_player_id(100));
+	GuidVector team_id_list;
+	for (Guid guid = 20; guid < 20 + 2 * (kMaxPlayerInviteSize + 1); guid += 2)
+	{
+		EXPECT_EQ(kOK, team_list.CreateTeam({ guid, UInt64Set{guid}}));
+		team_id_list.emplace_back(team_list.last_team_id());
+		EXPECT_EQ(kOK, team_list.InviteToTeam(team_id_list.back(), guid, 200));
+	}
+	EXPECT_EQ(kMaxPlayerInviteSize, team_list.invite_size_by_player_id(200));
+	EXPECT_FALSE(team_list.IsInvited(team_id_list.front(), 200));
+	EXPECT_EQ(0, team_list.invite_size_by_team_id(team_id_list.front()));
+
+	//decline, disband and joining another team drop the invite and its timer
+	EXPECT_EQ(kOK, team_list.DeclineInvite(team_id_list[1], 200));
+	EXPECT_FALSE(team_list.IsInvited(team_id_list[1], 200));
+	EXPECT_EQ(kRetTeamInviteNotFound, team_list.DeclineInvite(team_id_list[1], 200));
+	EXPECT_EQ(kOK, team_list.Disbanded(team_id_list[2], team_list.get_leader_id_by_team_id(team_id_list[2])));
+	EXPECT_EQ(kMaxPlayerInviteSize - 2, team_list.invite_size_by_player_id(200));
+	EXPECT_EQ(kOK, team_list.JoinTeam(team_id_list[3], 200));
+	EXPECT_EQ(0, team_list.invite_size_by_player_id(200));
+	EXPECT_EQ(0, team_list.invite_size_by_team_id(team_id_list[4]));
+	EXPECT_EQ(kMaxTeamInviteSize, TeamSystem::timing_wheel().size());
+
+	//every invite left expires together
+	std::vector<TeamTimer> expired;
+	TeamSystem::UpdateTimers(now + kTeamInviteTimeoutMs - 1, [&expired](const TeamTimer& team_timer) { expired.emplace_back(team_timer); });
+	EXPECT_TRUE(expired.empty());
+	TeamSystem::UpdateTimers(now + kTeamInviteTimeoutMs, [&expired](const TeamTimer& team_timer) { expired.emplace_back(team_timer); });
+	EXPECT_EQ(kMaxTeamInviteSize, expired.size());
+	EXPECT_EQ(TeamTimerType::kInvite, expired.front().type_);
+	EXPECT_EQ(team_id, expired.front().team_id_);
+	EXPECT_EQ(0, team_list.invite_size_by_team_id(team_id));
+	EXPECT_EQ(0, team_list.invite_size_by_player_id(101));
+	EXPECT_EQ(kRetTeamInviteNotFound, team_list.AcceptInvite(team_id, 101));
+	EXPECT_TRUE(TeamSystem::timing_wheel().empty());
+}
+
+TEST(TeamManger, ApplicantExpiry)
+{
+	TeamSystem team_list;
+	TeamSystemResetScope reset_scope;
+	const auto now = TeamSystem::timing_wheel().now();
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1, UInt64Set{1}}));
+	const auto team_id = team_list.last_team_id();
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 2, UInt64Set{2}}));
+	const auto other_team_id = team_list.last_team_id();
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 10));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(other_team_id, 10));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 11));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 12));
+	EXPECT_EQ(kOK, team_list.DelApplicant(team_id, 11));
+	EXPECT_EQ(3, TeamSystem::timing_wheel().size());
+
+	std::vector<TeamTimer> expired;
+	const auto on_expire = [&expired](const TeamTimer& team_timer) { expired.emplace_back(team_timer); };
+	TeamSystem::UpdateTimers(now + 1000, on_expire);
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 13));
+	TeamSystem::UpdateTimers(now + kTeamApplicantTimeoutMs, on_expire);
+	EXPECT_EQ(3, expired.size());
+	EXPECT_EQ(TeamTimerType::kApplicant, expired.front().type_);
+	EXPECT_FALSE(team_list.IsApplicant(team_id, 10));
+	EXPECT_FALSE(team_list.IsApplicant(other_team_id, 10));
+	EXPECT_FALSE(team_list.IsApplicant(team_id, 12));
+	EXPECT_EQ(0, team_list.apply_team_size_by_player_id(10));
+	EXPECT_EQ(13, team_list.first_applicant(team_id));
+
+	//joining cancels the deadline of every application the player had
+	EXPECT_EQ(kOK, team_list.JoinTeam(other_team_id, 13));
+	EXPECT_TRUE(TeamSystem::timing_wheel().empty());
+	TeamSystem::UpdateTimers(now + 1000 + kTeamApplicantTimeoutMs, on_expire);
+	EXPECT_EQ(3, expired.size());
+}
+
+static uint64_t g_admission_now_ms = 0;
+static uint64_t AdmissionTestClock() { return g_admission_now_ms; }
+
+TEST(TeamManger, Admission)
+{
+	TeamSystem team_list;
+	TeamSystemResetScope reset_scope;
+	g_admission_now_ms = 1000;
+	auto& admission = TeamSystem::admission();
+	admission.SetClock(&AdmissionTestClock);
+	admission.SetPlayerLimit({ 2, 1 });
+	admission.SetTeamLimit({ 3, 1 });
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1, UInt64Set{1}}));
+	const auto team_id = team_list.last_team_id();
+
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 10));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 10));
+	EXPECT_EQ(kRetTeamRequestRateLimited, team_list.ApplyToTeam(team_id, 10));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 11));
+	EXPECT_EQ(kRetTeamRequestRateLimited, team_list.JoinTeam(team_id, 12));
+	EXPECT_FALSE(team_list.HasMember(team_id, 12));
+	EXPECT_EQ(1, admission.counters(TeamOp::kApplyToTeam).player_rejected_);
+	EXPECT_EQ(0, admission.counters(TeamOp::kApplyToTeam).team_rejected_);
+	EXPECT_EQ(1, admission.counters(TeamOp::kJoinTeam).team_rejected_);
+	EXPECT_EQ(2, admission.rejected_size());
+	//the team side reject left 12's own bucket full
+	EXPECT_EQ(2, tls.registry.get<PlayerTeamRequestBucket>(TeamSystem::GetPlayer(12)).tokens());
+
+	//a second refills one token of each bucket without the timing wheel moving
+	g_admission_now_ms += 1000;
+	EXPECT_EQ(kOK, team_list.JoinTeam(team_id, 12));
+	EXPECT_EQ(1, tls.registry.get<PlayerTeamRequestBucket>(TeamSystem::GetPlayer(12)).tokens());
+	EXPECT_TRUE(team_list.HasMember(team_id, 12));
+	EXPECT_EQ(kRetTeamRequestRateLimited, team_list.ApplyToTeam(team_id, 10));
+	EXPECT_EQ(kRetTeamHasNotTeamId, team_list.ApplyToTeam(team_id + 100, 11));
+
+	admission.SetPlayerLimit({});
+	admission.SetTeamLimit({});
+	EXPECT_FALSE(admission.enabled());
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 10));
+	admission.SetClock(nullptr);
+	TeamSystem::Reset();
+	EXPECT_EQ(0, admission.rejected_size());
+}
+
+TEST(TeamManger, Raid)
+{
+	TeamSystem team_list;
+	TeamSystemResetScope reset_scope;
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1, UInt64Set{1}}));
+	const auto team_id = team_list.last_team_id();
+	for (Guid guid = 2; guid <= 5; ++guid)
+	{
+		EXPECT_EQ(kOK, team_list.JoinTeam(team_id, guid));
+	}
+	EXPECT_EQ(kRetTeamDismissNotLeader, team_list.CreateRaid(team_id, 2));
+	EXPECT_EQ(kOK, team_list.CreateRaid(team_id, 1));
+	EXPECT_EQ(kRetTeamMemberInTeam, team_list.CreateRaid(team_id, 1));
+	const auto raid_id = team_list.GetRaidId(3);
+	EXPECT_EQ(1, team_list.raid_size());
+	EXPECT_EQ(5, team_list.raid_member_size(raid_id));
+	EXPECT_EQ(1, team_list.get_leader_id_by_raid_id(raid_id));
+
+	//every group is full, the next player opens a new one
+	EXPECT_EQ(kOK, team_list.JoinRaid(raid_id, 6));
+	EXPECT_EQ(kRetTeamMemberInTeam, team_list.JoinRaid(raid_id, 1));
+	const auto other_team_id = team_list.GetTeamId(6);
+	EXPECT_NE(team_id, other_team_id);
+	EXPECT_EQ(6, team_list.get_leader_id_by_team_id(other_team_id));
+	EXPECT_EQ((std::vector<Guid>{team_id, other_team_id}), std::vector<Guid>(team_list.raid_team_list(raid_id).begin(), team_list.raid_team_list(raid_id).end()));
+	EXPECT_EQ(kOK, team_list.JoinTeam(other_team_id, 7));
+	EXPECT_TRUE(team_list.HasRaidMember(raid_id, 7));
+	EXPECT_EQ(7, team_list.raid_member_size(raid_id));
+
+	EXPECT_EQ(kRetTeamKickNotLeader, team_list.MoveRaidMember(raid_id, 2, 3, other_team_id));
+	EXPECT_EQ(kOK, team_list.MoveRaidMember(raid_id, 1, 3, other_team_id));
+	EXPECT_EQ(kRetTeamMemberInTeam, team_list.MoveRaidMember(raid_id, 1, 3, other_team_id));
+	EXPECT_EQ(other_team_id, team_list.GetTeamId(3));
+	EXPECT_TRUE(team_list.HasMember(other_team_id, 3));
+	EXPECT_FALSE(team_list.HasMember(team_id, 3));
+	EXPECT_EQ(kOK, team_list.MoveRaidMember(raid_id, 1, 1, other_team_id));
+	EXPECT_EQ(2, team_list.get_leader_id_by_team_id(team_id));
+	EXPECT_EQ(kOK, team_list.MoveRaidMember(raid_id, 1, 4, other_team_id));
+	EXPECT_EQ(kRetTeamMembersFull, team_list.MoveRaidMember(raid_id, 1, 2, other_team_id));
+	EXPECT_EQ(7, team_list.raid_member_size(raid_id));
+
+	EXPECT_EQ(kOK, team_list.LeaveTeam(1));
+	EXPECT_EQ(kInvalidGuid, team_list.GetRaidId(1));
+	EXPECT_EQ(2, team_list.get_leader_id_by_raid_id(raid_id));
+	EXPECT_EQ(kRetTeamAppointSelf, team_list.AppointRaidLeader(raid_id, 3, 6));
+	EXPECT_EQ(kOK, team_list.AppointRaidLeader(raid_id, 2, 6));
+
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 20, UInt64Set{20, 21}}));
+	const auto third_team_id = team_list.last_team_id();
+	EXPECT_EQ(kRetTeamKickNotLeader, team_list.AddRaidTeam(raid_id, 2, third_team_id));
+	EXPECT_EQ(kOK, team_list.AddRaidTeam(raid_id, 6, third_team_id));
+	EXPECT_TRUE(team_list.HasRaidMember(raid_id, 21));
+
+	//a group emptied by moves leaves the raid
+	EXPECT_EQ(kOK, team_list.MoveRaidMember(raid_id, 6, 20, team_id));
+	EXPECT_EQ(kOK, team_list.MoveRaidMember(raid_id, 6, 21, team_id));
+	EXPECT_EQ(2, team_list.raid_team_list(raid_id).size());
+	EXPECT_EQ(2, team_list.team_size());
+
+	EXPECT_EQ(kRetTeamDismissNotLeader, team_list.DisbandRaid(raid_id, 2));
+	EXPECT_EQ(kOK, team_list.DisbandRaid(raid_id, 6));
+	EXPECT_EQ(0, team_list.raid_size());
+	EXPECT_EQ(0, team_list.team_size());
+	EXPECT_FALSE(team_list.HasTeam(21));
+	EXPECT_EQ(kInvalidGuid, team_list.GetRaidId(6));
+	EXPECT_EQ(kRetTeamHasNotTeamId, team_list.JoinRaid(raid_id, 6));
+}
+
+TEST(TeamManger, MergeTeams)
+{
+	TeamSystem team_list;
+	TeamSystemResetScope reset_scope;
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1, UInt64Set{1}}));
+	const auto from_team_id = team_list.last_team_id();
+	EXPECT_EQ(kOK, team_list.JoinTeam(from_team_id, 2));
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 3, UInt64Set{3}, kTenMemberMaxSize }));
+	const auto team_id = team_list.last_team_id();
+	EXPECT_EQ(kOK, team_list.JoinTeam(team_id, 4));
+	EXPECT_EQ(kOK, team_list.JoinTeam(team_id, 5));
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 6, UInt64Set{6}}));
+	const auto other_team_id = team_list.last_team_id();
+	EXPECT_EQ(kOK, team_list.JoinTeam(other_team_id, 7));
+	EXPECT_EQ(kOK, team_list.JoinTeam(other_team_id, 8));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(from_team_id, 10));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(from_team_id, 11));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 11));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 12));
+	const auto players_size = team_list.players_size();
+
+	EXPECT_EQ(kRetTeamMemberInTeam, team_list.MergeTeams(team_id, team_id, 3));
+	EXPECT_EQ(kRetTeamMemberNotInTeam, team_list.MergeTeams(from_team_id, team_id, 6));
+	EXPECT_EQ(kRetTeamMembersFull, team_list.MergeTeams(team_id, other_team_id, 6));
+	EXPECT_EQ(kOK, team_list.MergeTeams(from_team_id, team_id, 1));
+	EXPECT_EQ(2, team_list.team_size());
+	EXPECT_EQ(players_size, team_list.players_size());
+	EXPECT_EQ(5, team_list.member_size(team_id));
+	EXPECT_EQ(team_id, team_list.GetTeamId(2));
+	EXPECT_EQ(1, team_list.get_leader_id_by_team_id(team_id));
+	EXPECT_EQ(3, team_list.applicant_size_by_team_id(team_id));
+	EXPECT_EQ(11, team_list.first_applicant(team_id));
+	EXPECT_TRUE(team_list.IsApplicant(team_id, 10));
+	EXPECT_EQ(1, team_list.apply_team_size_by_player_id(11));
+	EXPECT_EQ(3, TeamSystem::timing_wheel().size());
+
+	EXPECT_EQ(kRetTeamMemberNotInTeam, team_list.TransferMembers(team_id, other_team_id, UInt64Set{3, 99}));
+	EXPECT_EQ(kRetTeamMembersFull, team_list.TransferMembers(team_id, other_team_id, UInt64Set{1, 3, 4}));
+	EXPECT_EQ(kOK, team_list.TransferMembers(team_id, other_team_id, UInt64Set{1, 2}));
+	EXPECT_EQ(3, team_list.member_size(team_id));
+	EXPECT_EQ(5, team_list.member_size(other_team_id));
+	EXPECT_EQ(other_team_id, team_list.GetTeamId(1));
+	EXPECT_EQ(3, team_list.get_leader_id_by_team_id(team_id));
+	EXPECT_EQ(3, team_list.applicant_size_by_team_id(team_id));
+
+	//moving every member out erases the team
+	EXPECT_EQ(kOK, team_list.TransferMembers(other_team_id, team_id, UInt64Set{1, 2, 6, 7, 8}));
+	EXPECT_EQ(1, team_list.team_size());
+	EXPECT_EQ(8, team_list.member_size(team_id));
+	EXPECT_EQ(team_id, team_list.GetTeamId(6));
+	EXPECT_EQ(players_size, team_list.players_size());
+
+	//members merged into a raid group join the raid
+	EXPECT_EQ(kOK, team_list.CreateRaid(team_id, 3));
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 20, UInt64Set{20}}));
+	EXPECT_EQ(kOK, team_list.MergeTeams(team_list.last_team_id(), team_id, 3));
+	EXPECT_TRUE(team_list.HasRaidMember(team_list.GetRaidId(3), 20));
+	EXPECT_EQ(9, team_list.raid_member_size(team_list.GetRaidId(3)));
+}
+
+TEST(TeamManger, GuidSimd)
+{
+	//stale guids past size must never match
+	Guid data[GuidPaddedSize(kTenMemberMaxSize)]{};
+	for (std::size_t i = 0; i < std::size(data); ++i)
+	{
+		data[i] = 1000 + i % 7;
+	}
+	const Guid guid_list[] = { 1000, 1003, 1006, 999, kInvalidGuid };
+	const auto scalar = GuidSimdFor(GuidSimdLevel::kScalar);
+	for (auto level = GuidSimdLevel::kScalar; level <= GuidSimdSupportedLevel(); level = static_cast<GuidSimdLevel>(static_cast<uint8_t>(level) + 1))
+	{
+		const auto simd = GuidSimdFor(level);
+		EXPECT_EQ(level, simd.level_);
+		for (const auto guid : guid_list)
+		{
+			EXPECT_EQ(scalar.match_(data, std::size(data), guid), simd.match_(data, std::size(data), guid));
+		}
+		uint8_t hit_list[std::size(guid_list)]{};
+		simd.batch_match_(data, std::size(data), 5, guid_list, std::size(guid_list), hit_list);
+		EXPECT_EQ((std::vector<uint8_t>{1, 1, 0, 0, 0}), std::vector<uint8_t>(std::begin(hit_list), std::end(hit_list)));
+	}
+	EXPECT_EQ(0b1'0000'0010u, GuidMatch(data, std::size(data), 1001));
+
+	TeamSystem team_list;
+	TeamSystemResetScope reset_scope;
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1, UInt64Set{1, 2, 3, 4, 5}}));
+	const auto team_id = team_list.last_team_id();
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 6, UInt64Set{6, 7, 8, 9, 10, 11, 12, 13, 14, 15}, kTenMemberMaxSize }));
+	const auto other_team_id = team_list.last_team_id();
+	EXPECT_EQ(kOK, team_list.LeaveTeam(5));
+	EXPECT_FALSE(team_list.HasMember(team_id, 5));
+	EXPECT_TRUE(team_list.HasMember(other_team_id, 15));
+	GuidVector team_id_by_guid;
+	EXPECT_EQ(3, team_list.FindMembers({ 2, 5, 15, 16, 6 }, { team_id, other_team_id, team_id + 1000 }, team_id_by_guid));
+	EXPECT_EQ((GuidVector{ team_id, kInvalidGuid, other_team_id, kInvalidGuid, other_team_id }), team_id_by_guid);
+}
+
+TEST(TeamManger, ColdApplicants)
+{
+	TeamSystem team_list;
+	TeamSystemResetScope reset_scope;
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1, UInt64Set{1}}));
+	const auto team_id = team_list.last_team_id();
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 2, UInt64Set{2}}));
+	const auto other_team_id = team_list.last_team_id();
+	EXPECT_EQ(0, tls.registry.storage<TeamApplicants>().size());
+	EXPECT_EQ(kInvalidGuid, team_list.first_applicant(team_id));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 10));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(team_id, 11));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(other_team_id, 10));
+	EXPECT_EQ(2, tls.registry.storage<TeamApplicants>().size());
+	EXPECT_EQ(kOK, team_list.DelApplicant(team_id, 11));
+	EXPECT_EQ(2, tls.registry.storage<TeamApplicants>().size());
+	EXPECT_EQ(kOK, team_list.JoinTeam(team_id, 10));
+	EXPECT_EQ(0, tls.registry.storage<TeamApplicants>().size());
+	EXPECT_EQ(0, team_list.applicant_size_by_team_id(other_team_id));
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(other_team_id, 12));
+	team_list.ClearApplyList(other_team_id);
+	EXPECT_EQ(0, tls.registry.storage<TeamApplicants>().size());
+	EXPECT_EQ(kOK, team_list.ApplyToTeam(other_team_id, 12));
+	EXPECT_EQ(kOK, team_list.DisbandedTeamNoLeader(other_team_id));
+	EXPECT_EQ(0, tls.registry.storage<TeamApplicants>().size());
+	EXPECT_EQ(0, team_list.apply_team_size_by_player_id(12));
+}
+
+TEST(TeamManger, CommandBuffer)
+{
+	TeamSystem team_list;
+	TeamSystemResetScope reset_scope;
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 1, UInt64Set{1}}));
+	const auto team_id = team_list.last_team_id();
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 2, UInt64Set{2}}));
+	const auto other_team_id = team_list.last_team_id();
+	EXPECT_EQ(kOK, team_list.CreateTeam({ 3, UInt64Set{3}}));
+	const auto disband_team_id = team_list.last_team_id();
+
+	TeamCommandBuffer command_buffer(team_list);
+	TeamCommand create{ TeamCommandType::kCreateTeam, 1, kInvalidGuid, 20, kInvalidGuid, {} };
+	create.member_list_.emplace_back(20);
+	create.member_list_.emplace_back(11);
+	command_buffer.Push(create);
+	command_buffer.Push({ TeamCommandType::kJoinTeam, 2, other_team_id, 10, kInvalidGuid, {} });
+	command_buffer.Push({ TeamCommandType::kJoinTeam, 3, team_id, 10, kInvalidGuid, {} });
+	command_buffer.Push({ TeamCommandType::kApplyToTeam, 4, team_id, 12, kInvalidGuid, {} });
+	command_buffer.Push({ TeamCommandType::kJoinTeam, 5, team_id, 11, kInvalidGuid, {} });
+	command_buffer.Push({ TeamCommandType::kDisbanded, 6, disband_team_id, 3, kInvalidGuid, {} });
+	command_buffer.Push({ TeamCommandType::kApplyToTeam, 7, disband_team_id, 13, kInvalidGuid, {} });
+	command_buffer.Push({ TeamCommandType::kAppointLeader, 8, team_id, 1, 11, {} });
+	EXPECT_EQ(8, command_buffer.size());
+	TeamCommandResultVector result_list;
+	command_buffer.Flush(result_list);
+	EXPECT_TRUE(command_buffer.empty());
+	ASSERT_EQ(8, result_list.size());
+	for (uint64_t i = 0; i < result_list.size(); ++i)
+	{
+		EXPECT_EQ(i + 1, result_list[i].request_id_);
+	}
+	//every player's commands keep their arrival order: 10 joins the team it asked for first
+	//and 11 is in the new team before it asks to join
+	EXPECT_EQ(kOK, result_list[0].ret_);
+	const auto create_team_id = result_list[0].team_id_;
+	EXPECT_TRUE(team_list.HasMember(create_team_id, 11));
+	EXPECT_EQ(kOK, result_list[1].ret_);
+	EXPECT_EQ(kRetTeamMemberInTeam, result_list[2].ret_);
+	EXPECT_EQ(kOK, result_list[3].ret_);
+	EXPECT_EQ(kRetTeamMemberInTeam, result_list[4].ret_);
+	EXPECT_EQ(kOK, result_list[5].ret_);
+	EXPECT_EQ(kRetTeamHasNotTeamId, result_list[6].ret_);
+	EXPECT_NE(kOK, result_list[7].ret_);
+	EXPECT_EQ(1, team_list.get_leader_id_by_team_id(team_id));
+	EXPECT_EQ(1, team_list.member_size(team_id));
+	EXPECT_TRUE(team_list.HasMember(other_team_id, 10));
+	EXPECT_TRUE(team_list.IsApplicant(team_id, 12));
+	EXPECT_EQ(3, team_list.team_size());
+
+	command_buffer.Push(create);
+	command_buffer.Flush(result_list);
+	ASSERT_EQ(1, result_list.size());
+	EXPECT_EQ(kRetTeamMemberInTeam, result_list[0].ret_);
+	create.guid_ = 21;
+	create.member_list_.clear();
+	create.member_list_.emplace_back(21);
+	command_buffer.Push(create);
+	command_buffer.Flush(result_list);
+	EXPECT_EQ(kOK, result_list[0].ret_);
+	EXPECT_EQ(team_list.last_team_id(), result_list[0].team_id_);
+
+	//a create carries its team type
+	create.guid_ = 22;
+	create.member_list_.clear();
+	for (Guid guid = 22; guid < 22 + kTenMemberMaxSize; ++guid)
+	{
+		create.member_list_.emplace_back(guid);
+	}
+	command_buffer.Push(create);
+	create.team_type_size_ = kTenMemberMaxSize;
+	command_buffer.Push(create);
+	command_buffer.Flush(result_list);
+	ASSERT_EQ(2, result_list.size());
+	EXPECT_EQ(kRetTeamCreateTeamMaxMemberSize, result_list[0].ret_);
+	EXPECT_EQ(kOK, result_list[1].ret_);
+	EXPECT_EQ(kTenMemberMaxSize, team_list.member_size(result_list[1].team_id_));
+	EXPECT_TRUE(team_list.IsTeamFull(result_list[1].team_id_));
+
+	//leaving the higher team id and joining the lower one in the same tick still ends up in the lower team
+	const auto low_team_id = std::min(team_id, other_team_id);
+	const auto high_team_id = std::max(team_id, other_team_id);
+	EXPECT_EQ(kOK, team_list.JoinTeam(high_team_id, 14));
+	command_buffer.Push({ TeamCommandType::kLeaveTeam, 9, high_team_id, 14, kInvalidGuid, {} });
+	command_buffer.Push({ TeamCommandType::kJoinTeam, 10, low_team_id, 14, kInvalidGuid, {} });
+	command_buffer.Flush(result_list);
+	ASSERT_EQ(2, result_list.size());
+	EXPECT_EQ(kOK, result_list[0].ret_);
+	EXPECT_EQ(kOK, result_list[1].ret_);
+	EXPECT_TRUE(team_list.HasMember(low_team_id, 14));
+	EXPECT_FALSE(team_list.HasMember(high_team_id, 14));
+}
+
 int main(int argc, char** argv)
 {
 	for (size_t i = 0; i < 2000; ++i)
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+//hierarchical timing wheel, 4 levels of 256 slots cover 2^32 ticks.
+//add, cancel and expire are O(1) per timer; a timer is moved down a level at most 3 times before it fires.
+//timers live in one node array linked into slot lists by index, freed nodes are reused
+template <typename T>
+class TimingWheel
+{
+public:
+	using TimerId = uint64_t;
+	static constexpr TimerId kInvalidTimerId = 0;
+
+	explicit TimingWheel(const uint64_t now = 0) : now_(now)
+	{
+		for (auto& slot : slot_list_)
+		{
+			slot = kNullNode;
+		}
+	}
+
+	inline uint64_t now() const { return now_; }
+	inline std::size_t size() const { return size_; }
+	inline bool empty() const { return size_ == 0; }
+
+	//a deadline that already passed fires on the next tick
+	TimerId Add(uint64_t expire, const T& value)
+	{
+		if (expire <= now_)
+		{
+			expire = now_ + 1;
+		}
+		if (expire - now_ >= kMaxDelta)
+		{
+			expire = now_ + kMaxDelta - 1;
+		}
+		uint32_t index = free_;
+		if (kNullNode == index)
+		{
+			index = static_cast<uint32_t>(node_list_.size());
+			node_list_.emplace_back();
+		}
+		else
+		{
+			free_ = node_list_[index].next_;
+		}
+		auto& node = node_list_[index];
+		node.value_ = value;
+		node.expire_ = expire;
+		Link(index);
+		++size_;
+		return (static_cast<TimerId>(node.generation_) << 32) | index;
+	}
+
+	//false when the timer already fired or was cancelled
+	bool Cancel(const TimerId timer_id)
+	{
+		const auto index = static_cast<uint32_t>(timer_id);
+		if (index >= node_list_.size() || node_list_[index].generation_ != static_cast<uint32_t>(timer_id >> 32) || kNullNode == node_list_[index].slot_)
+		{
+			return false;
+		}
+		Unlink(index);
+		Free(index);
+		return true;
+	}
+
+	//fires every timer due up to now in deadline order, on_expire may add or cancel timers.
+	//ticks of empty lower levels are skipped up to the next cascade, so a long gap costs no more than a few rotations
+	template <typename Func>
+	void Advance(const uint64_t now, Func&& on_expire)
+	{
+		while (now_ < now)
+		{
+			if (0 == size_)
+			{
+				now_ = now;
+				return;
+			}
+			uint32_t empty_level = 0;
+			while (empty_level < kLevelSize && 0 == level_size_[empty_level])
+			{
+				++empty_level;
+			}
+			if (empty_level > 0)
+			{
+				const auto boundary = now_ | ((uint64_t{ 1 } << (kSlotBits * empty_level)) - 1);
+				now_ = std::min(now, boundary);
+				if (now_ == now)
+				{
+					return;
+				}
+			}
+			++now_;
+			for (uint32_t level = 1; level < kLevelSize && 0 == ((now_ >> (kSlotBits * (level - 1))) & kSlotMask); ++level)
+			{
+				Cascade(level * kSlotSize + ((now_ >> (kSlotBits * level)) & kSlotMask));
+			}
+			auto& head = slot_list_[now_ & kSlotMask];
+			while (kNullNode != head)
+			{
+				const auto index = head;
+				Unlink(index);
+				const T value = node_list_[index].value_;
+				Free(index);
+				on_expire(value);
+			}
+		}
+	}
+
+	void Clear()
+	{
+		node_list_.clear();
+		for (auto& slot : slot_list_)
+		{
+			slot = kNullNode;
+		}
+		free_ = kNullNode;
+		size_ = 0;
+		std::fill(std::begin(level_size_), std::end(level_size_), 0);
+	}
+
+private:
+	static constexpr uint32_t kNullNode = UINT32_MAX;
+	static constexpr uint32_t kSlotBits = 8;
+	static constexpr uint32_t kSlotSize = 1 << kSlotBits;
+	static constexpr uint64_t kSlotMask = kSlotSize - 1;
+	static constexpr uint32_t kLevelSize = 4;
+	static constexpr uint64_t kMaxDelta = uint64_t{ 1 } << (kSlotBits * kLevelSize);
+
+	struct Node
+	{
+		T value_{};
+		uint64_t expire_{ 0 };
+		uint32_t prev_{ kNullNode };
+		uint32_t next_{ kNullNode };
+		uint32_t slot_{ kNullNode };
+		uint32_t generation_{ 1 };
+	};
+
+	uint32_t SlotOf(const uint64_t expire) const
+	{
+		const auto delta = expire - now_;
+		uint32_t level = 0;
+		while (level + 1 < kLevelSize && delta >= (uint64_t{ 1 } << (kSlotBits * (level + 1))))
+		{
+			++level;
+		}
+		return level * kSlotSize + static_cast<uint32_t>((expire >> (kSlotBits * level)) & kSlotMask);
+	}
+
+	void Link(const uint32_t index)
+	{
+		auto& node = node_list_[index];
+		node.slot_ = SlotOf(node.expire_);
+		auto& head = slot_list_[node.slot_];
+		++level_size_[node.slot_ / kSlotSize];
+		node.prev_ = kNullNode;
+		node.next_ = head;
+		if (kNullNode != head)
+		{
+			node_list_[head].prev_ = index;
+		}
+		head = index;
+	}
+
+	void Unlink(const uint32_t index)
+	{
+		auto& node = node_list_[index];
+		if (kNullNode == node.prev_)
+		{
+			slot_list_[node.slot_] = node.next_;
+		}
+		else
+		{
+			node_list_[node.prev_].next_ = node.next_;
+		}
+		if (kNullNode != node.next_)
+		{
+			node_list_[node.next_].prev_ = node.prev_;
+		}
+		--level_size_[node.slot_ / kSlotSize];
+		node.slot_ = kNullNode;
+	}
+
+	void Free(const uint32_t index)
+	{
+		auto& node = node_list_[index];
+		++node.generation_;
+		node.next_ = free_;
+		free_ = index;
+		--size_;
+	}
+
+	//moves every timer of a higher level slot to the level its deadline now falls in
+	void Cascade(const uint32_t slot)
+	{
+		auto index = slot_list_[slot];
+		slot_list_[slot] = kNullNode;
+		while (kNullNode != index)
+		{
+			const auto next = node_list_[index].next_;
+			--level_size_[slot / kSlotSize];
+			Link(index);
+			index = next;
+		}
+	}
+
+	std::vector<Node> node_list_;
+	uint32_t slot_list_[kSlotSize * kLevelSize];
+	uint32_t free_{ kNullNode };
+	std::size_t size_{ 0 };
+	std::size_t level_size_[kLevelSize]{};
+	uint64_t now_{ 0 };
+};